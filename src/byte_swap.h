@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define RVIZ_COLORIZE_BYTE_SWAP_SSSE3
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define RVIZ_COLORIZE_BYTE_SWAP_NEON
+#endif
+
+namespace rviz
+{
+namespace byte_swap
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    constexpr bool HOST_IS_BIG_ENDIAN = true;
+#else
+    constexpr bool HOST_IS_BIG_ENDIAN = false;
+#endif
+
+    template <size_t Size>
+    struct UnsignedOfSize;
+    template <>
+    struct UnsignedOfSize<1>
+    {
+        typedef uint8_t type;
+    };
+    template <>
+    struct UnsignedOfSize<2>
+    {
+        typedef uint16_t type;
+    };
+    template <>
+    struct UnsignedOfSize<4>
+    {
+        typedef uint32_t type;
+    };
+    template <>
+    struct UnsignedOfSize<8>
+    {
+        typedef uint64_t type;
+    };
+
+    inline uint8_t swapScalar(uint8_t value)
+    {
+        return value;
+    }
+
+    inline uint16_t swapScalar(uint16_t value)
+    {
+        return __builtin_bswap16(value);
+    }
+
+    inline uint32_t swapScalar(uint32_t value)
+    {
+        return __builtin_bswap32(value);
+    }
+
+    inline uint64_t swapScalar(uint64_t value)
+    {
+        return __builtin_bswap64(value);
+    }
+
+#if defined(RVIZ_COLORIZE_BYTE_SWAP_SSSE3)
+    // SSSE3 is not part of the x86-64 baseline, the shuffle kernel is compiled for it separately and selected at
+    // runtime
+    inline bool hasSSSE3()
+    {
+        static const bool has_ssse3 = __builtin_cpu_supports("ssse3");
+        return has_ssse3;
+    }
+
+    // swaps the bytes of all elements of size element_size in 16 byte blocks, returns the number of swapped bytes
+    __attribute__((target("ssse3"))) inline size_t swapBlocks(uint8_t* data, size_t num_bytes, size_t element_size)
+    {
+        const __m128i shuffle16 = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+        const __m128i shuffle32 = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        const __m128i shuffle64 = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+        const __m128i shuffle = element_size == 2 ? shuffle16 : (element_size == 4 ? shuffle32 : shuffle64);
+
+        size_t i = 0;
+        for (; i + 16 <= num_bytes; i += 16)
+        {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), _mm_shuffle_epi8(block, shuffle));
+        }
+        return i;
+    }
+#elif defined(RVIZ_COLORIZE_BYTE_SWAP_NEON)
+    inline size_t swapBlocks(uint8_t* data, size_t num_bytes, size_t element_size)
+    {
+        size_t i = 0;
+        for (; i + 16 <= num_bytes; i += 16)
+        {
+            uint8x16_t block = vld1q_u8(data + i);
+            block = element_size == 2 ? vrev16q_u8(block) : (element_size == 4 ? vrev32q_u8(block) : vrev64q_u8(block));
+            vst1q_u8(data + i, block);
+        }
+        return i;
+    }
+#endif
+
+    // reverses the byte order of count elements in place
+    template <typename Bits>
+    inline void swap(Bits* data, const size_t count)
+    {
+        size_t i = sizeof(Bits) == 1 ? count : 0;
+#if defined(RVIZ_COLORIZE_BYTE_SWAP_SSSE3)
+        if (sizeof(Bits) > 1 && hasSSSE3())
+        {
+            i = swapBlocks(reinterpret_cast<uint8_t*>(data), count * sizeof(Bits), sizeof(Bits)) / sizeof(Bits);
+        }
+#elif defined(RVIZ_COLORIZE_BYTE_SWAP_NEON)
+        if (sizeof(Bits) > 1)
+        {
+            i = swapBlocks(reinterpret_cast<uint8_t*>(data), count * sizeof(Bits), sizeof(Bits)) / sizeof(Bits);
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            data[i] = swapScalar(data[i]);
+        }
+    }
+
+} // namespace byte_swap
+} // namespace rviz
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <cstddef>
+
+namespace rviz
+{
+namespace color_maps
+{
+    // All color maps are sampled into tables at compile time, so picking one at runtime only selects a table and
+    // coloring a point is a single lookup.
+    constexpr size_t TABLE_SIZE = 256;
+
+    enum ColorMap
+    {
+        RAINBOW,
+        TURBO,
+        VIRIDIS,
+        INFERNO,
+        CYCLIC,
+        MIN_MAX_COLOR
+    };
+
+    struct RGB
+    {
+        float r;
+        float g;
+        float b;
+    };
+
+    struct Table
+    {
+        float rgb[TABLE_SIZE][3];
+    };
+
+    constexpr float clamp01(float value)
+    {
+        return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+    }
+
+    // this is HSV color palette with hue values going only from 0.0 to 0.833333, low values are red.
+    struct Rainbow
+    {
+        static constexpr RGB at(float t)
+        {
+            const float value = 1.0f - t;
+            const float h = value * 5.0f + 1.0f;
+            const int i = static_cast<int>(h);
+            const float f = (i & 1) ? h - i : 1.0f - (h - i);
+            const float n = 1.0f - f;
+
+            if (i <= 1)
+                return RGB{n, 0.0f, 1.0f};
+            if (i == 2)
+                return RGB{0.0f, n, 1.0f};
+            if (i == 3)
+                return RGB{0.0f, 1.0f, n};
+            if (i == 4)
+                return RGB{n, 1.0f, 0.0f};
+            return RGB{1.0f, n, 0.0f};
+        }
+    };
+
+    // polynomial approximation of Google's Turbo color map
+    struct Turbo
+    {
+        static constexpr RGB at(float t)
+        {
+            const float t2 = t * t;
+            const float t3 = t2 * t;
+            const float t4 = t2 * t2;
+            const float t5 = t4 * t;
+            return RGB{clamp01(0.13572138f + 4.61539260f * t - 42.66032258f * t2 + 132.13108234f * t3 -
+                               152.94239396f * t4 + 59.28637943f * t5),
+                       clamp01(0.09140261f + 2.19418839f * t + 4.84296658f * t2 - 14.18503333f * t3 +
+                               4.27729857f * t4 + 2.82956604f * t5),
+                       clamp01(0.10667330f + 12.64194608f * t - 60.58204836f * t2 + 110.36276771f * t3 -
+                               89.90310912f * t4 + 27.34824973f * t5)};
+        }
+    };
+
+    constexpr float horner6(float t, float c0, float c1, float c2, float c3, float c4, float c5, float c6)
+    {
+        return c0 + t * (c1 + t * (c2 + t * (c3 + t * (c4 + t * (c5 + t * c6)))));
+    }
+
+    // 6th degree polynomial fits of the matplotlib color maps
+    struct Viridis
+    {
+        static constexpr RGB at(float t)
+        {
+            return RGB{clamp01(horner6(t, 0.2777273272f, 0.1050930431f, -0.3308618287f, -4.634230499f, 6.228269936f,
+                                       4.776384998f, -5.435455856f)),
+                       clamp01(horner6(t, 0.0054073445f, 1.404613530f, 0.2148475595f, -5.799100973f, 14.17993337f,
+                                       -13.74514538f, 4.645852612f)),
+                       clamp01(horner6(t, 0.3340998053f, 1.384590163f, 0.0950951630f, -19.33244096f, 56.69055260f,
+                                       -65.35303263f, 26.31243525f))};
+        }
+    };
+
+    struct Inferno
+    {
+        static constexpr RGB at(float t)
+        {
+            return RGB{clamp01(horner6(t, 0.0002189404f, 0.1065134195f, 11.60249308f, -41.70399613f, 77.16293570f,
+                                       -71.31942824f, 25.13112622f)),
+                       clamp01(horner6(t, 0.0016510046f, 0.5639564368f, -3.972853966f, 17.43639888f, -33.40235894f,
+                                       32.62606426f, -12.24266895f)),
+                       clamp01(horner6(t, -0.0194808984f, 3.932712389f, -15.94239411f, 44.35414520f, -81.80730926f,
+                                       73.20951986f, -23.07032500f))};
+        }
+    };
+
+    // full hue circle with softened saturation, both ends have the same color (e.g. for azimuth or phase)
+    struct Cyclic
+    {
+        static constexpr float channel(float hue)
+        {
+            // hue in [0, 6), distance based piecewise linear HSV channel
+            return hue < 1.0f ? 1.0f
+                 : hue < 2.0f ? 2.0f - hue
+                 : hue < 4.0f ? 0.0f
+                 : hue < 5.0f ? hue - 4.0f
+                              : 1.0f;
+        }
+
+        static constexpr float wrap(float hue)
+        {
+            return hue >= 6.0f ? hue - 6.0f : hue;
+        }
+
+        static constexpr float soften(float value)
+        {
+            return 0.2f + 0.75f * value;
+        }
+
+        static constexpr RGB at(float t)
+        {
+            return RGB{soften(channel(wrap(t * 6.0f))),
+                       soften(channel(wrap(t * 6.0f + 4.0f))),
+                       soften(channel(wrap(t * 6.0f + 2.0f)))};
+        }
+    };
+
+    template <typename Map>
+    constexpr Table makeTable()
+    {
+        Table table{};
+        for (size_t i = 0; i < TABLE_SIZE; ++i)
+        {
+            const RGB rgb = Map::at(static_cast<float>(i) / static_cast<float>(TABLE_SIZE - 1));
+            table.rgb[i][0] = rgb.r;
+            table.rgb[i][1] = rgb.g;
+            table.rgb[i][2] = rgb.b;
+        }
+        return table;
+    }
+
+    constexpr Table RAINBOW_TABLE = makeTable<Rainbow>();
+    constexpr Table TURBO_TABLE = makeTable<Turbo>();
+    constexpr Table VIRIDIS_TABLE = makeTable<Viridis>();
+    constexpr Table INFERNO_TABLE = makeTable<Inferno>();
+    constexpr Table CYCLIC_TABLE = makeTable<Cyclic>();
+
+    // returns nullptr for MIN_MAX_COLOR, which interpolates between two user defined colors instead
+    inline const Table* getTable(int color_map)
+    {
+        switch (color_map)
+        {
+            case RAINBOW:
+                return &RAINBOW_TABLE;
+            case TURBO:
+                return &TURBO_TABLE;
+            case VIRIDIS:
+                return &VIRIDIS_TABLE;
+            case INFERNO:
+                return &INFERNO_TABLE;
+            case CYCLIC:
+                return &CYCLIC_TABLE;
+            default:
+                return nullptr;
+        }
+    }
+
+    // maps a normalized value to a table row, values outside [0, 1] and NaN are clamped
+    inline size_t getIndex(float value)
+    {
+        value = value >= 0.0f ? (value <= 1.0f ? value : 1.0f) : 0.0f;
+        return static_cast<size_t>(value * static_cast<float>(TABLE_SIZE - 1) + 0.5f);
+    }
+
+} // namespace color_maps
+} // namespace rviz
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <sensor_msgs/PointCloud2.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "byte_swap.h"
+
+namespace rviz
+{
+    enum TimeOrigin
+    {
+        TIME_ORIGIN_HEADER,
+        TIME_ORIGIN_MINIMUM,
+        // the channel already holds offsets, e.g. relative to the header stamp
+        TIME_ORIGIN_NONE
+    };
+
+    template <typename Stored, typename T>
+    inline void readFieldAs(const sensor_msgs::PointCloud2& cloud, const uint32_t offset, T* out)
+    {
+        const uint8_t* data = cloud.data.data() + offset;
+        const uint32_t point_step = cloud.point_step;
+        const uint32_t num_points = cloud.width * cloud.height;
+        for (uint32_t i = 0; i < num_points; ++i)
+        {
+            Stored val;
+            std::memcpy(&val, data + point_step * i, sizeof(Stored));
+            out[i] = static_cast<T>(val);
+        }
+    }
+
+    // Same as readFieldAs for clouds of the other byte order. The values are gathered into small blocks which are
+    // byte swapped as a whole, so the swap can use vector shuffles.
+    template <typename Stored, typename T>
+    inline void readSwappedFieldAs(const sensor_msgs::PointCloud2& cloud, const uint32_t offset, T* out)
+    {
+        typedef typename byte_swap::UnsignedOfSize<sizeof(Stored)>::type Bits;
+        const size_t block_size = 64;
+        Bits block[block_size];
+
+        const uint8_t* data = cloud.data.data() + offset;
+        const uint32_t point_step = cloud.point_step;
+        const uint32_t num_points = cloud.width * cloud.height;
+        for (uint32_t begin = 0; begin < num_points; begin += block_size)
+        {
+            const uint32_t count = std::min<uint32_t>(block_size, num_points - begin);
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                std::memcpy(&block[i], data + point_step * (begin + i), sizeof(Bits));
+            }
+            byte_swap::swap(block, count);
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                Stored val;
+                std::memcpy(&val, &block[i], sizeof(Stored));
+                out[begin + i] = static_cast<T>(val);
+            }
+        }
+    }
+
+    template <typename Stored, typename T>
+    inline void readFieldAs(const sensor_msgs::PointCloud2& cloud, const uint32_t offset, const bool swap, T* out)
+    {
+        if (swap && sizeof(Stored) > 1)
+        {
+            readSwappedFieldAs<Stored>(cloud, offset, out);
+        }
+        else
+        {
+            readFieldAs<Stored>(cloud, offset, out);
+        }
+    }
+
+    inline bool isIntegerField(const sensor_msgs::PointField& field)
+    {
+        return field.datatype != sensor_msgs::PointField::FLOAT32 && field.datatype != sensor_msgs::PointField::FLOAT64;
+    }
+
+    // Decodes one field of all points into a contiguous buffer. The datatype and byte order are dispatched once per
+    // cloud, clouds in host byte order take the plain copy loop.
+    // Like valueFromCloud, signed integer fields are read as their unsigned counterpart.
+    template <typename T>
+    inline void readField(const sensor_msgs::PointCloud2& cloud, const sensor_msgs::PointField& field, std::vector<T>& out)
+    {
+        out.resize(cloud.width * cloud.height);
+        const bool swap = cloud.is_bigendian != byte_swap::HOST_IS_BIG_ENDIAN;
+        switch (field.datatype)
+        {
+            case sensor_msgs::PointField::INT8:
+            case sensor_msgs::PointField::UINT8:
+                readFieldAs<uint8_t>(cloud, field.offset, swap, out.data());
+                break;
+            case sensor_msgs::PointField::INT16:
+            case sensor_msgs::PointField::UINT16:
+                readFieldAs<uint16_t>(cloud, field.offset, swap, out.data());
+                break;
+            case sensor_msgs::PointField::INT32:
+            case sensor_msgs::PointField::UINT32:
+                readFieldAs<uint32_t>(cloud, field.offset, swap, out.data());
+                break;
+            case sensor_msgs::PointField::FLOAT32:
+                readFieldAs<float>(cloud, field.offset, swap, out.data());
+                break;
+            case sensor_msgs::PointField::FLOAT64:
+                readFieldAs<double>(cloud, field.offset, swap, out.data());
+                break;
+            default:
+                std::fill(out.begin(), out.end(), T(0));
+                break;
+        }
+    }
+
+    // Decodes a per point time field as offsets to a time origin. The subtraction is done in double so absolute
+    // float64 stamps keep their sub-millisecond resolution, only the (small) offsets are converted to float.
+    inline void readTimeField(const sensor_msgs::PointCloud2& cloud,
+                              const sensor_msgs::PointField& field,
+                              const TimeOrigin origin,
+                              std::vector<double>& times,
+                              std::vector<float>& out)
+    {
+        readField(cloud, field, times);
+
+        double time_origin = 0.0;
+        if (origin == TIME_ORIGIN_HEADER)
+        {
+            time_origin = cloud.header.stamp.toSec();
+        }
+        else if (origin == TIME_ORIGIN_MINIMUM)
+        {
+            time_origin = std::numeric_limits<double>::infinity();
+            for (const double t : times)
+            {
+                if (t < time_origin)
+                {
+                    time_origin = t;
+                }
+            }
+            if (!std::isfinite(time_origin))
+            {
+                time_origin = 0.0;
+            }
+        }
+
+        out.resize(times.size());
+        const double* in_ptr = times.data();
+        float* out_ptr = out.data();
+        const size_t num_points = times.size();
+        for (size_t i = 0; i < num_points; ++i)
+        {
+            out_ptr[i] = static_cast<float>(in_ptr[i] - time_origin);
+        }
+    }
+
+} // namespace rviz
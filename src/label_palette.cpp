@@ -0,0 +1,197 @@
+#include "label_palette.h"
+
+#include <yaml-cpp/yaml.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace rviz
+{
+
+namespace
+{
+    bool endsWith(const std::string& str, const std::string& suffix)
+    {
+        return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    std::string trim(const std::string& str)
+    {
+        const size_t begin = str.find_first_not_of(" \t\r\"");
+        if (begin == std::string::npos)
+        {
+            return "";
+        }
+        const size_t end = str.find_last_not_of(" \t\r\"");
+        return str.substr(begin, end - begin + 1);
+    }
+
+    bool parseInt(const std::string& str, long& value)
+    {
+        const std::string trimmed = trim(str);
+        char* end = nullptr;
+        value = std::strtol(trimmed.c_str(), &end, 10);
+        return !trimmed.empty() && *end == '\0';
+    }
+
+    bool parseBool(const std::string& str)
+    {
+        const std::string trimmed = trim(str);
+        return !(trimmed == "0" || trimmed == "false" || trimmed == "False" || trimmed == "no");
+    }
+
+    Ogre::ColourValue colorFromRgb(long r, long g, long b)
+    {
+        return Ogre::ColourValue(r / 255.f, g / 255.f, b / 255.f);
+    }
+
+    Ogre::ColourValue colorFromYaml(const YAML::Node& node, bool bgr)
+    {
+        const long first = node[0].as<long>();
+        const long second = node[1].as<long>();
+        const long third = node[2].as<long>();
+        return bgr ? colorFromRgb(third, second, first) : colorFromRgb(first, second, third);
+    }
+} // namespace
+
+LabelPalette::ConstPtr LabelPalette::load(const std::string& path, std::string& error)
+{
+    std::vector<Entry> entries;
+    const bool csv = endsWith(path, ".csv") || endsWith(path, ".txt");
+    if (!(csv ? parseCsv(path, entries, error) : parseYaml(path, entries, error)))
+    {
+        return nullptr;
+    }
+    if (entries.empty())
+    {
+        error = "no labels found in " + path;
+        return nullptr;
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.id < b.id; });
+    const size_t size = entries.back().id + 1;
+
+    std::shared_ptr<LabelPalette> palette = std::make_shared<LabelPalette>();
+    palette->colors_.assign(size, Ogre::ColourValue());
+    palette->defined_.assign(size, 0);
+    palette->visible_.assign(size, 1);
+    for (const Entry& entry : entries)
+    {
+        palette->colors_[entry.id] = entry.color;
+        palette->defined_[entry.id] = 1;
+        palette->visible_[entry.id] = entry.visible;
+        if (!entry.name.empty())
+        {
+            palette->names_.emplace_back(entry.id, entry.name);
+        }
+    }
+    return palette;
+}
+
+bool LabelPalette::parseCsv(const std::string& path, std::vector<Entry>& entries, std::string& error)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        line = line.substr(0, line.find('#'));
+        std::vector<std::string> columns;
+        std::stringstream stream(line);
+        std::string column;
+        while (std::getline(stream, column, ','))
+        {
+            columns.push_back(column);
+        }
+
+        long id;
+        long r;
+        long g;
+        long b;
+        // skips empty lines and a header line
+        if (columns.size() < 5 || !parseInt(columns[0], id) || !parseInt(columns[2], r) || !parseInt(columns[3], g) ||
+            !parseInt(columns[4], b) || id < 0 || id > 0xFFFF)
+        {
+            continue;
+        }
+        Entry entry;
+        entry.id = static_cast<uint16_t>(id);
+        entry.name = trim(columns[1]);
+        entry.color = colorFromRgb(r, g, b);
+        entry.visible = columns.size() < 6 || parseBool(columns[5]);
+        entries.push_back(entry);
+    }
+    return true;
+}
+
+bool LabelPalette::parseYaml(const std::string& path, std::vector<Entry>& entries, std::string& error)
+{
+    try
+    {
+        const YAML::Node root = YAML::LoadFile(path);
+        if (root["classes"])
+        {
+            for (const YAML::Node& node : root["classes"])
+            {
+                const long id = node["id"].as<long>();
+                if (id < 0 || id > 0xFFFF)
+                {
+                    continue;
+                }
+                Entry entry;
+                entry.id = static_cast<uint16_t>(id);
+                entry.name = node["name"] ? node["name"].as<std::string>() : "";
+                entry.color = node["color"] ? colorFromYaml(node["color"], false) : Ogre::ColourValue();
+                entry.visible = node["visible"] ? node["visible"].as<bool>() : true;
+                entries.push_back(entry);
+            }
+        }
+        else if (root["color_map"])
+        {
+            // SemanticKITTI layout, the colors are stored as BGR
+            std::map<long, std::string> names;
+            if (root["labels"])
+            {
+                for (const auto& label : root["labels"])
+                {
+                    names[label.first.as<long>()] = label.second.as<std::string>();
+                }
+            }
+            for (const auto& color : root["color_map"])
+            {
+                const long id = color.first.as<long>();
+                if (id < 0 || id > 0xFFFF)
+                {
+                    continue;
+                }
+                Entry entry;
+                entry.id = static_cast<uint16_t>(id);
+                entry.name = names[id];
+                entry.color = colorFromYaml(color.second, true);
+                entry.visible = true;
+                entries.push_back(entry);
+            }
+        }
+        else
+        {
+            error = path + " has neither a \"classes\" nor a \"color_map\" entry";
+            return false;
+        }
+    }
+    catch (const YAML::Exception& e)
+    {
+        error = "cannot parse " + path + ": " + e.what();
+        return false;
+    }
+    return true;
+}
+
+} // namespace rviz
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <OgreColourValue.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rviz
+{
+
+// Label colors, names and visibility loaded from a dataset palette file, compiled into dense tables indexed by the
+// label id. Ids without an entry keep the given fallback color and are visible.
+//
+// Supported formats:
+//  - CSV (.csv, .txt): one "id,name,r,g,b[,visible]" line per label, r/g/b in 0..255, '#' starts a comment
+//  - YAML with a "classes" list of {id, name, color: [r, g, b], visible}
+//  - YAML in the SemanticKITTI config layout: "labels" (id: name) and "color_map" (id: [b, g, r])
+class LabelPalette
+{
+  public:
+    typedef std::shared_ptr<const LabelPalette> ConstPtr;
+
+    // returns nullptr and sets error if the file cannot be read
+    static ConstPtr load(const std::string& path, std::string& error);
+
+    const Ogre::ColourValue& color(uint16_t label, const Ogre::ColourValue& fallback) const
+    {
+        return label < colors_.size() && defined_[label] ? colors_[label] : fallback;
+    }
+
+    bool visible(uint16_t label) const
+    {
+        return label >= visible_.size() || visible_[label];
+    }
+
+    // returns nullptr if the label has no name
+    const std::string* name(uint16_t label) const
+    {
+        const auto it = std::lower_bound(names_.begin(),
+                                         names_.end(),
+                                         label,
+                                         [](const std::pair<uint16_t, std::string>& entry, uint16_t id)
+                                         { return entry.first < id; });
+        return it != names_.end() && it->first == label ? &it->second : nullptr;
+    }
+
+    // (id, name) of all labels with a name, sorted by id
+    const std::vector<std::pair<uint16_t, std::string>>& names() const
+    {
+        return names_;
+    }
+
+  private:
+    struct Entry
+    {
+        uint16_t id;
+        std::string name;
+        Ogre::ColourValue color;
+        bool visible;
+    };
+
+    static bool parseCsv(const std::string& path, std::vector<Entry>& entries, std::string& error);
+    static bool parseYaml(const std::string& path, std::vector<Entry>& entries, std::string& error);
+
+    std::vector<Ogre::ColourValue> colors_;
+    std::vector<uint8_t> defined_;
+    std::vector<uint8_t> visible_;
+    std::vector<std::pair<uint16_t, std::string>> names_;
+};
+
+} // namespace rviz
@@ -0,0 +1,63 @@
+#include "label_palette_file.h"
+
+#include <rviz/properties/string_property.h>
+
+#include <ros/ros.h>
+
+#include <QFileSystemWatcher>
+
+namespace rviz
+{
+
+Property* LabelPaletteFile::createProperty(Property* parent)
+{
+    path_property_ = new StringProperty("Palette File",
+                                        "",
+                                        "YAML or CSV file mapping label ids to names, colors and visibility. The file "
+                                        "is reloaded when it changes.",
+                                        parent,
+                                        SLOT(updatePath()),
+                                        this);
+    watcher_ = new QFileSystemWatcher(this);
+    connect(watcher_, &QFileSystemWatcher::fileChanged, this, &LabelPaletteFile::reload);
+    return path_property_;
+}
+
+void LabelPaletteFile::updatePath()
+{
+    if (!watcher_->files().isEmpty())
+    {
+        watcher_->removePaths(watcher_->files());
+    }
+    const std::string path = path_property_->getStdString();
+    if (!path.empty())
+    {
+        watcher_->addPath(QString::fromStdString(path));
+    }
+    reload();
+}
+
+void LabelPaletteFile::reload()
+{
+    const std::string path = path_property_->getStdString();
+    LabelPalette::ConstPtr palette;
+    if (!path.empty())
+    {
+        std::string error;
+        palette = LabelPalette::load(path, error);
+        // editors often replace the file on save, which drops it from the watcher
+        if (!watcher_->files().contains(QString::fromStdString(path)))
+        {
+            watcher_->addPath(QString::fromStdString(path));
+        }
+        if (!palette)
+        {
+            ROS_WARN_STREAM("Failed to load label palette, keeping the last one: " << error);
+            return;
+        }
+    }
+    std::atomic_store(&palette_, palette);
+    Q_EMIT changed();
+}
+
+} // namespace rviz
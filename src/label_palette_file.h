@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QObject>
+
+#include <atomic>
+#include <memory>
+
+#include "label_palette.h"
+
+class QFileSystemWatcher;
+
+namespace rviz
+{
+
+class Property;
+class StringProperty;
+
+// The "Palette File" of the label transformers. The file is watched and reloaded when it changes. A file which fails
+// to load (e.g. while it is being saved) keeps the last good palette, only an empty path clears it.
+class LabelPaletteFile : public QObject
+{
+    Q_OBJECT
+  public:
+    // creates the property below parent and returns it
+    Property* createProperty(Property* parent);
+
+    // the current palette or nullptr, it is swapped atomically on reload so transform() never waits for a load
+    LabelPalette::ConstPtr palette() const
+    {
+        return std::atomic_load(&palette_);
+    }
+
+  Q_SIGNALS:
+    // emitted after the palette was loaded or cleared
+    void changed();
+
+  private Q_SLOTS:
+    void updatePath();
+    void reload();
+
+  private:
+    LabelPalette::ConstPtr palette_;
+    QFileSystemWatcher* watcher_{nullptr};
+    StringProperty* path_property_{nullptr};
+};
+
+} // namespace rviz
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace rviz
+{
+namespace normalization
+{
+    enum Mode
+    {
+        LINEAR,
+        LOG,
+        SQRT,
+        GAMMA
+    };
+
+    // log2 of a positive, finite value from the float exponent and a polynomial of the mantissa (abs. error 9e-6).
+    // The polynomial has no constant term and is exact at both ends of the mantissa range, so powers of two (1 in
+    // particular) map exactly and small arguments keep a small relative error. Branch free, so loops over it vectorize.
+    inline float fastLog2(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        const float exponent = static_cast<float>(static_cast<int32_t>(bits >> 23) - 127);
+        bits = (bits & 0x007FFFFFu) | 0x3F800000u;
+        float m;
+        std::memcpy(&m, &bits, sizeof(m));
+        m -= 1.0f;
+        return exponent +
+               m * (1.44268196f +
+                    m * (-0.720369274f +
+                         m * (0.468650657f + m * (-0.301384014f + m * (0.143935547f + m * -0.0335148802f)))));
+    }
+
+    // 2^value for value >= -126 from the float exponent and a polynomial of the fraction (rel. error 7e-6)
+    inline float fastExp2(float value)
+    {
+        value = std::max(value, -126.0f);
+        const float floor_value = std::floor(value);
+        const float f = value - floor_value;
+        const float p = 1.00000728f + f * (0.692931289f + f * (0.241710262f + f * (0.0516668774f + f * 0.0136765311f)));
+        uint32_t bits;
+        std::memcpy(&bits, &p, sizeof(bits));
+        bits += static_cast<uint32_t>(static_cast<int32_t>(floor_value)) << 23;
+        float result;
+        std::memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+
+    // Normalizes channel values to [0, 1] with a linear, logarithmic, square root or gamma curve between the bounds.
+    // The log curve log(1 + k x) / log(1 + k) is applied to the linearly normalized value x, so its shape only depends
+    // on the scale k and not on the units of the channel.
+    // Whole buffers are processed with one tight loop per mode. Integer channels with a small value range use a table
+    // of the curve instead.
+    class Normalizer
+    {
+      public:
+        // the linear result is not clamped, so it is identical to (value - min_value) / diff_value
+        void setup(Mode mode, float gamma, float log_scale, float min_value, float diff_value)
+        {
+            mode_ = mode;
+            gamma_ = gamma;
+            log_scale_ = std::max(log_scale, 1e-6f);
+            min_value_ = min_value;
+            diff_value_ = diff_value;
+            inv_log_scale_ = 1.0f / fastLog2(1.0f + log_scale_);
+        }
+
+        void apply(const std::vector<float>& values, bool integer_channel, std::vector<float>& out)
+        {
+            const size_t num_values = values.size();
+            out.resize(num_values);
+            const float* in_ptr = values.data();
+            float* out_ptr = out.data();
+
+            if (mode_ == LINEAR)
+            {
+                for (size_t i = 0; i < num_values; ++i)
+                {
+                    out_ptr[i] = (in_ptr[i] - min_value_) / diff_value_;
+                }
+                return;
+            }
+
+            // integer values between the bounds are looked up, the rest is clamped to the ends of the table
+            const float table_size = std::floor(diff_value_) + 1.0f;
+            if (integer_channel && min_value_ == std::floor(min_value_) && table_size >= 1.0f &&
+                table_size <= std::min<float>(num_values, 65536.0f))
+            {
+                table_.resize(static_cast<size_t>(table_size));
+                for (size_t k = 0; k < table_.size(); ++k)
+                {
+                    table_[k] = curve(static_cast<float>(k) / diff_value_);
+                }
+                const float max_index = table_size - 1.0f;
+                for (size_t i = 0; i < num_values; ++i)
+                {
+                    float index = in_ptr[i] - min_value_;
+                    index = index >= 0.0f ? (index <= max_index ? index : max_index) : 0.0f;
+                    out_ptr[i] = table_[static_cast<size_t>(index)];
+                }
+                return;
+            }
+
+            switch (mode_)
+            {
+                case LOG:
+                    for (size_t i = 0; i < num_values; ++i)
+                    {
+                        // clamped with comparisons, so NaN values end up at the lower bound like in the other modes
+                        float linear = (in_ptr[i] - min_value_) / diff_value_;
+                        linear = linear > 0.0f ? (linear < 1.0f ? linear : 1.0f) : 0.0f;
+                        out_ptr[i] = fastLog2(1.0f + log_scale_ * linear) * inv_log_scale_;
+                    }
+                    break;
+                case SQRT:
+                    for (size_t i = 0; i < num_values; ++i)
+                    {
+                        const float linear = std::min(std::max((in_ptr[i] - min_value_) / diff_value_, 0.0f), 1.0f);
+                        out_ptr[i] = std::sqrt(linear);
+                    }
+                    break;
+                case GAMMA:
+                    for (size_t i = 0; i < num_values; ++i)
+                    {
+                        const float linear = std::min(std::max((in_ptr[i] - min_value_) / diff_value_, 0.0f), 1.0f);
+                        out_ptr[i] = linear > 0.0f ? fastExp2(gamma_ * fastLog2(linear)) : 0.0f;
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+
+      private:
+        // curve of a linearly normalized value
+        float curve(float linear) const
+        {
+            linear = std::min(std::max(linear, 0.0f), 1.0f);
+            switch (mode_)
+            {
+                case LOG:
+                    return fastLog2(1.0f + log_scale_ * linear) * inv_log_scale_;
+                case SQRT:
+                    return std::sqrt(linear);
+                case GAMMA:
+                    return linear > 0.0f ? fastExp2(gamma_ * fastLog2(linear)) : 0.0f;
+                default:
+                    return linear;
+            }
+        }
+
+        Mode mode_{LINEAR};
+        float gamma_{1.0f};
+        float log_scale_{1.0f};
+        float min_value_{0.0f};
+        float diff_value_{1.0f};
+        float inv_log_scale_{1.0f};
+        std::vector<float> table_;
+    };
+
+} // namespace normalization
+} // namespace rviz
@@ -1,49 +1,194 @@
 #include <rviz/default_plugin/point_cloud_transformers.h>
 #include <rviz/properties/bool_property.h>
 #include <rviz/properties/editable_enum_property.h>
+#include <rviz/properties/enum_property.h>
 #include <rviz/properties/int_property.h>
 #include <rviz/properties/float_property.h>
 #include <rviz/properties/color_property.h>
+#include <rviz/properties/string_property.h>
+
+#include <std_msgs/UInt32MultiArray.h>
+
+#include <algorithm>
+#include <cstdlib>
 
 #include <ogre_helpers/color_material_helper.h>
 
+#include "color_maps.h"
+#include "field_reader.h"
+#include "normalization.h"
 #include "point_cloud_transformers.h"
 
 namespace rviz
 {
-    static void getRainbowColorLabel(float value, Ogre::ColourValue& color)
+namespace
+{
+    // compares the field names of a cloud with the sorted list of known channels without allocating, as this runs
+    // for every transformer on each cloud
+    bool channelsChanged(const sensor_msgs::PointCloud2& cloud, const std::vector<std::string>& channels)
     {
-        // this is HSV color palette with hue values going only from 0.0 to 0.833333.
+        if (cloud.fields.size() != channels.size())
+        {
+            return true;
+        }
+        for (const auto& field : cloud.fields)
+        {
+            if (!std::binary_search(channels.begin(), channels.end(), field.name))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
 
-        value = std::min(value, 1.0f);
-        value = std::max(value, 0.0f);
+    // index of the channel, "intensity" falls back to the "intensities" channel some drivers publish
+    int32_t findValueChannel(const sensor_msgs::PointCloud2ConstPtr& cloud, const std::string& name)
+    {
+        int32_t index = findChannelIndex(cloud, name);
+        if (index == -1 && name == "intensity")
+        {
+            index = findChannelIndex(cloud, "intensities");
+        }
+        return index;
+    }
 
-        float h = value * 5.0f + 1.0f;
-        int i = floor(h);
-        float f = h - i;
-        if (!(i & 1))
-            f = 1 - f; // if i is even
-        float n = 1 - f;
+    // rviz's XYZ transformer copies the coordinates in host byte order, so the positions of clouds in the other byte
+    // order are garbage. They are decoded again here, before the region of interest and the filters look at them.
+    // Like in the XYZ transformer only float32 coordinates are handled.
+    void decodeSwappedPositions(const sensor_msgs::PointCloud2ConstPtr& cloud,
+                                std::vector<float>& values,
+                                V_PointCloudPoint& points_out)
+    {
+        if (cloud->is_bigendian == byte_swap::HOST_IS_BIG_ENDIAN)
+        {
+            return;
+        }
+        const int32_t x_index = findChannelIndex(cloud, "x");
+        const int32_t y_index = findChannelIndex(cloud, "y");
+        const int32_t z_index = findChannelIndex(cloud, "z");
+        if (x_index == -1 || y_index == -1 || z_index == -1 ||
+            cloud->fields[x_index].datatype != sensor_msgs::PointField::FLOAT32 ||
+            cloud->fields[y_index].datatype != sensor_msgs::PointField::FLOAT32 ||
+            cloud->fields[z_index].datatype != sensor_msgs::PointField::FLOAT32)
+        {
+            return;
+        }
 
-        if (i <= 1)
-            color[0] = n, color[1] = 0, color[2] = 1;
-        else if (i == 2)
-            color[0] = 0, color[1] = n, color[2] = 1;
-        else if (i == 3)
-            color[0] = 0, color[1] = 1, color[2] = n;
-        else if (i == 4)
-            color[0] = n, color[1] = 1, color[2] = 0;
-        else if (i >= 5)
-            color[0] = 1, color[1] = n, color[2] = 0;
+        const size_t num_points = std::min(points_out.size(), static_cast<size_t>(cloud->width * cloud->height));
+        readField(*cloud, cloud->fields[x_index], values);
+        for (size_t i = 0; i < num_points; ++i)
+        {
+            points_out[i].position.x = values[i];
+        }
+        readField(*cloud, cloud->fields[y_index], values);
+        for (size_t i = 0; i < num_points; ++i)
+        {
+            points_out[i].position.y = values[i];
+        }
+        readField(*cloud, cloud->fields[z_index], values);
+        for (size_t i = 0; i < num_points; ++i)
+        {
+            points_out[i].position.z = values[i];
+        }
     }
 
-uint8_t LabelPCTransformer::supports(const sensor_msgs::PointCloud2ConstPtr& cloud)
+    // writes the colors of a colorized cloud into the points and hides the filtered ones. Transformers which do not
+    // compute the alpha keep the alpha of the points.
+    void applyColorizedCloud(const ColorizedCloud& colorized, const bool with_alpha, V_PointCloudPoint& points_out)
+    {
+        const size_t num_points = colorized.colors.size();
+        for (size_t i = 0; i < num_points; ++i)
+        {
+            Ogre::ColourValue& color = points_out[i].color;
+            if (with_alpha)
+            {
+                color = colorized.colors[i];
+            }
+            else
+            {
+                color.r = colorized.colors[i].r;
+                color.g = colorized.colors[i].g;
+                color.b = colorized.colors[i].b;
+            }
+
+            if (colorized.hidden[i])
+            {
+                color.a = 0.f;
+                // put those points to origin in order to not accidentally select them with the selection tool
+                points_out[i].position.x = 0.f;
+                points_out[i].position.y = 0.f;
+                points_out[i].position.z = 0.f;
+            }
+        }
+    }
+
+    // normalizes the values between the bounds with the curve and looks up their colors in the color map, without a
+    // color map the colors are interpolated between min_color and max_color
+    void applyColorMap(const normalization::Mode mode,
+                       const float gamma,
+                       const float log_scale,
+                       const float min_value,
+                       const float max_value,
+                       const bool integer_values,
+                       const color_maps::Table* color_map,
+                       const bool invert_color_map,
+                       const Ogre::ColourValue& min_color,
+                       const Ogre::ColourValue& max_color,
+                       ColorizedCloud& out)
+    {
+        float diff_value = max_value - min_value;
+        if (diff_value == 0)
+        {
+            // If min and max are equal, set the diff to something huge so
+            // when we divide by it, we effectively get zero.  That way the
+            // point cloud coloring will be predictably uniform when min and
+            // max are equal.
+            diff_value = 1e20;
+        }
+        out.normalizer.setup(mode, gamma, log_scale, min_value, diff_value);
+        out.normalizer.apply(out.values, integer_values, out.normalized);
+
+        const size_t num_points = out.normalized.size();
+        if (color_map)
+        {
+            for (size_t i = 0; i < num_points; ++i)
+            {
+                float value = out.normalized[i];
+                if (invert_color_map)
+                {
+                    value = 1.0f - value;
+                }
+                const float* rgb = color_map->rgb[color_maps::getIndex(value)];
+                out.colors[i].r = rgb[0];
+                out.colors[i].g = rgb[1];
+                out.colors[i].b = rgb[2];
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < num_points; ++i)
+            {
+                float normalized_value = out.normalized[i];
+                normalized_value = std::min(1.0f, std::max(0.0f, normalized_value));
+                out.colors[i].r = max_color.r * normalized_value + min_color.r * (1.0f - normalized_value);
+                out.colors[i].g = max_color.g * normalized_value + min_color.g * (1.0f - normalized_value);
+                out.colors[i].b = max_color.b * normalized_value + min_color.b * (1.0f - normalized_value);
+            }
+        }
+    }
+} // namespace
+
+ColorPCTransformer::ColorPCTransformer(bool with_alpha) : with_alpha_(with_alpha)
+{
+}
+
+uint8_t ColorPCTransformer::supports(const sensor_msgs::PointCloud2ConstPtr& cloud)
 {
     updateChannels(cloud);
     return Support_Color;
 }
 
-bool LabelPCTransformer::transform(const sensor_msgs::PointCloud2ConstPtr& cloud,
+bool ColorPCTransformer::transform(const sensor_msgs::PointCloud2ConstPtr& cloud,
                                    uint32_t mask,
                                    const Ogre::Matrix4& transform,
                                    V_PointCloudPoint& points_out)
@@ -52,8 +197,117 @@ bool LabelPCTransformer::transform(const sensor_msgs::PointCloud2ConstPtr& cloud
     {
         return false;
     }
+    decodeSwappedPositions(cloud, swapped_positions_, points_out);
+
+    const bool roi_active = roi_.update(transform, points_out);
+    if (!colorize(cloud, roi_active ? &roi_.outside() : nullptr, colorized_))
+    {
+        return false;
+    }
+
+    applyColorizedCloud(colorized_, with_alpha_, points_out);
+
+    if (voxel_thinning_property_->getBool())
+    {
+        voxel_thinning_.apply(voxel_size_property_->getFloat(), points_out);
+    }
+
+    return true;
+}
+
+uint8_t ColorPCTransformer::score(const sensor_msgs::PointCloud2ConstPtr& cloud)
+{
+    return 255;
+}
+
+void ColorPCTransformer::addChannelProperty(EditableEnumProperty* property)
+{
+    channel_properties_.push_back(property);
+}
+
+void ColorPCTransformer::createCommonProperties(Property* parent_property, QList<Property*>& out_props)
+{
+    voxel_thinning_property_ = new BoolProperty("Voxel Thinning",
+                                                false,
+                                                "Show only one point per voxel to reduce overdraw of dense clouds",
+                                                parent_property,
+                                                SIGNAL(needRetransform()),
+                                                this);
+    voxel_thinning_property_->setDisableChildrenIfFalse(true);
+    voxel_size_property_ = new FloatProperty("Voxel Size",
+                                             0.05,
+                                             "Edge length of the voxels in meters",
+                                             voxel_thinning_property_,
+                                             SIGNAL(needRetransform()),
+                                             this);
+    voxel_size_property_->setMin(0.01);
+
+    out_props.push_back(roi_.createProperties(parent_property));
+    connect(&roi_, &RegionOfInterest::needRetransform, this, &ColorPCTransformer::needRetransform);
+    out_props.push_back(voxel_thinning_property_);
+}
+
+void ColorPCTransformer::postCloudProperties()
+{
+    if (!cloud_properties_pending_.exchange(true))
+    {
+        QMetaObject::invokeMethod(this, "applyCloudProperties", Qt::QueuedConnection);
+    }
+}
+
+void ColorPCTransformer::applyCloudProperties()
+{
+    // cleared before reading the values, so a cloud colorized meanwhile posts again
+    cloud_properties_pending_ = false;
+    updateCloudProperties();
+}
+
+void ColorPCTransformer::updateChannels(const sensor_msgs::PointCloud2ConstPtr& cloud)
+{
+    if (!channelsChanged(*cloud, available_channels_))
+    {
+        return;
+    }
+
+    std::vector<std::string> channels;
+    for (const auto& field : cloud->fields)
+    {
+        channels.push_back(field.name);
+    }
+    std::sort(channels.begin(), channels.end());
 
-    int32_t index = findChannelIndex(cloud, channel_name_property_->getStdString());
+    if (channels != available_channels_)
+    {
+        for (EditableEnumProperty* property : channel_properties_)
+        {
+            property->clearOptions();
+        }
+        for (auto& channel : channels)
+        {
+            if (channel.empty())
+            {
+                continue;
+            }
+            for (EditableEnumProperty* property : channel_properties_)
+            {
+                property->addOptionStd(channel);
+            }
+        }
+        available_channels_ = channels;
+    }
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+LabelPCTransformer::LabelPCTransformer() : ColorPCTransformer(true)
+{
+}
+
+bool LabelPCTransformer::colorize(const sensor_msgs::PointCloud2ConstPtr& cloud,
+                                  const std::vector<uint8_t>* outside,
+                                  ColorizedCloud& out)
+{
+    int32_t index = findChannelIndex(cloud, channel_name_);
 
     if (index == -1)
     {
@@ -61,50 +315,183 @@ bool LabelPCTransformer::transform(const sensor_msgs::PointCloud2ConstPtr& cloud
     }
 
     bool show_only_activated = show_only_property_->getBool();
-    uint16_t show_only_desired_value = show_only_value_property_->getInt();
-    uint32_t show_only_index;
+    uint16_t show_only_desired_value = show_only_value_;
+    int32_t show_only_index = -1;
     if (show_only_activated)
     {
-        show_only_index = findChannelIndex(cloud, show_only_channel_name_property_->getStdString());
+        show_only_index = findChannelIndex(cloud, show_only_channel_name_);
 
         if (show_only_index == -1)
         {
             return false;
         }
     }
-    const uint32_t offset = cloud->fields[index].offset;
-    const uint8_t type = cloud->fields[index].datatype;
-    const uint32_t point_step = cloud->point_step;
     const uint32_t num_points = cloud->width * cloud->height;
 
+    readField(*cloud, cloud->fields[index], out.labels);
+    if (show_only_activated)
+    {
+        readField(*cloud, cloud->fields[show_only_index], out.filter_labels);
+    }
+
+    out.colors.resize(num_points);
+    out.hidden.resize(num_points);
+    const bool statistics = statistics_property_->getBool();
+    if (statistics)
+    {
+        std::fill(label_counts_.begin(), label_counts_.end(), 0);
+    }
+
+    // the palette may be swapped by a reload at any time, the copy keeps the current one for the whole cloud
+    const LabelPalette::ConstPtr palette = palette_file_.palette();
+
     for (uint32_t i = 0; i < num_points; ++i)
     {
-        auto val = valueFromCloud<uint16_t>(cloud, offset, type, point_step, i);
-        points_out[i].color =
+        uint16_t val = out.labels[i];
+        Ogre::ColourValue color =
             ColorHelper::getOgreColorFromList(val % static_cast<int>(ColorHelper::getColorListSize()));
+        if (palette)
+        {
+            color = palette->color(val, color);
+        }
+        out.colors[i] = color;
 
-        if (show_only_activated)
+        // only points inside the region of interest are counted
+        const bool is_outside = outside && (*outside)[i];
+        if (statistics && !is_outside)
         {
-            const uint32_t show_only_offset = cloud->fields[show_only_index].offset;
-            const uint8_t show_only_type = cloud->fields[show_only_index].datatype;
-            auto show_only_val = valueFromCloud<uint16_t>(cloud, show_only_offset, show_only_type, point_step, i);
-            if(show_only_val != show_only_desired_value)
+            if (val >= label_counts_.size())
             {
-                points_out[i].color.a = 0.f;
-                // put those points to origin in order to not accidentally select them with the selection tool
-                points_out[i].position.x = 0.f;
-                points_out[i].position.y = 0.f;
-                points_out[i].position.z = 0.f;
+                label_counts_.resize(val + 1, 0);
             }
+            ++label_counts_[val];
         }
+
+        // an explicit show only value overrides the default visibility of the palette
+        bool hidden = palette && !palette->visible(val);
+        if (show_only_activated)
+        {
+            uint16_t show_only_val = out.filter_labels[i];
+            hidden = show_only_val != show_only_desired_value;
+        }
+        out.hidden[i] = hidden || is_outside;
+    }
+
+    if (statistics)
+    {
+        updateLabelStatistics(palette);
     }
 
     return true;
 }
 
-uint8_t LabelPCTransformer::score(const sensor_msgs::PointCloud2ConstPtr& cloud)
+void LabelPCTransformer::updateLabelStatistics(const LabelPalette::ConstPtr& palette)
 {
-    return 255;
+    const std::vector<uint32_t>& label_counts = label_counts_;
+    top_labels_.clear();
+    for (size_t label = 0; label < label_counts.size(); ++label)
+    {
+        if (label_counts[label] > 0)
+        {
+            top_labels_.emplace_back(static_cast<uint16_t>(label), label_counts[label]);
+        }
+    }
+
+    const size_t top_n = std::min(static_cast<size_t>(std::max(statistics_top_n_property_->getInt(), 0)),
+                                  top_labels_.size());
+    std::partial_sort(top_labels_.begin(),
+                      top_labels_.begin() + top_n,
+                      top_labels_.end(),
+                      [](const std::pair<uint16_t, uint32_t>& a, const std::pair<uint16_t, uint32_t>& b)
+                      { return a.second > b.second || (a.second == b.second && a.first < b.first); });
+
+    {
+        // assigning keeps the capacity, so this does not allocate once the rows were filled
+        std::lock_guard<std::mutex> lock(cloud_properties_mutex_);
+        shown_top_labels_.assign(top_labels_.begin(), top_labels_.begin() + top_n);
+        shown_palette_ = palette;
+    }
+    postCloudProperties();
+
+    if (statistics_publish_property_->getBool() && statistics_pub_)
+    {
+        // compact encoding: consecutive (label, count) pairs sorted by descending count
+        std_msgs::UInt32MultiArray& msg = statistics_msg_;
+        if (msg.layout.dim.size() != 2)
+        {
+            msg.layout.dim.resize(2);
+            msg.layout.dim[0].label = "labels";
+            msg.layout.dim[1].label = "label_count";
+            msg.layout.dim[1].size = 2;
+            msg.layout.dim[1].stride = 2;
+        }
+        msg.layout.dim[0].size = top_n;
+        msg.layout.dim[0].stride = 2 * top_n;
+        msg.data.clear();
+        for (size_t i = 0; i < top_n; ++i)
+        {
+            msg.data.push_back(top_labels_[i].first);
+            msg.data.push_back(top_labels_[i].second);
+        }
+        statistics_pub_.publish(msg);
+    }
+}
+
+void LabelPCTransformer::updateCloudProperties()
+{
+    std::lock_guard<std::mutex> lock(cloud_properties_mutex_);
+    const size_t num_rows = std::min(label_count_properties_.size(),
+                                     static_cast<size_t>(std::max(statistics_top_n_property_->getInt(), 0)));
+    // the names are only rebuilt when a row shows another label or the palette was reloaded
+    const bool palette_changed = shown_palette_ != label_count_palette_;
+    label_count_palette_ = shown_palette_;
+    for (size_t i = 0; i < num_rows; ++i)
+    {
+        const bool shown = i < shown_top_labels_.size();
+        if (shown)
+        {
+            const uint16_t label = shown_top_labels_[i].first;
+            if (palette_changed || label_count_ids_[i] != label)
+            {
+                const std::string* name = shown_palette_ ? shown_palette_->name(label) : nullptr;
+                label_count_properties_[i]->setName(
+                    name ? QString("Label %1 (%2)").arg(label).arg(QString::fromStdString(*name))
+                         : QString("Label %1").arg(label));
+                label_count_ids_[i] = label;
+            }
+            label_count_properties_[i]->setValue(static_cast<int>(shown_top_labels_[i].second));
+        }
+        label_count_properties_[i]->setHidden(!shown);
+    }
+}
+
+// creates the rows of the counts on the main thread, rows beyond Top N are kept hidden for when it grows again
+void LabelPCTransformer::updateStatisticsRows()
+{
+    const size_t top_n = static_cast<size_t>(std::max(statistics_top_n_property_->getInt(), 0));
+    while (label_count_properties_.size() < top_n)
+    {
+        Property* prop = new Property("Label", 0, "Number of points with this label", statistics_counts_property_);
+        prop->setReadOnly(true);
+        prop->setHidden(true);
+        label_count_properties_.push_back(prop);
+        label_count_ids_.push_back(-1);
+    }
+    for (size_t i = top_n; i < label_count_properties_.size(); ++i)
+    {
+        label_count_properties_[i]->setHidden(true);
+    }
+    Q_EMIT needRetransform();
+}
+
+void LabelPCTransformer::updateStatisticsTopic()
+{
+    statistics_pub_.shutdown();
+    if (statistics_publish_property_->getBool() && !statistics_topic_property_->getStdString().empty())
+    {
+        statistics_pub_ =
+            nh_.advertise<std_msgs::UInt32MultiArray>(statistics_topic_property_->getStdString(), 1);
+    }
 }
 
 void LabelPCTransformer::createProperties(Property* parent_property, uint32_t mask, QList<Property*>& out_props)
@@ -115,7 +502,7 @@ void LabelPCTransformer::createProperties(Property* parent_property, uint32_t ma
                                                           "sem_label",
                                                           "Select the channel to use to colorize by label",
                                                           parent_property,
-                                                          SIGNAL(needRetransform()),
+                                                          SLOT(updateChannelNames()),
                                                           this);
         show_only_property_ = new BoolProperty(
             "Show only", false, "Show only points with value", parent_property, SIGNAL(needRetransform()), this);
@@ -124,124 +511,551 @@ void LabelPCTransformer::createProperties(Property* parent_property, uint32_t ma
                                                                     "sem_label",
                                                                     "Select the channel by which to hide",
                                                                     show_only_property_,
-                                                                    SIGNAL(needRetransform()),
+                                                                    SLOT(updateChannelNames()),
                                                                     this);
-        show_only_value_property_ =
-            new IntProperty("Equal To", 0, "Select the value", show_only_property_, SIGNAL(needRetransform()), this);
+        show_only_value_property_ = new EditableEnumProperty(
+            "Equal To", "0", "Select the value", show_only_property_, SLOT(updateChannelNames()), this);
+
+        Property* palette_file_property = palette_file_.createProperty(parent_property);
+        connect(&palette_file_, &LabelPaletteFile::changed, this, &LabelPCTransformer::updatePaletteOptions);
+
+        statistics_property_ = new BoolProperty("Label Statistics",
+                                                false,
+                                                "Count the points of each label in the current cloud",
+                                                parent_property,
+                                                SIGNAL(needRetransform()),
+                                                this);
+        statistics_property_->setDisableChildrenIfFalse(true);
+        statistics_top_n_property_ = new IntProperty("Top N",
+                                                     5,
+                                                     "Number of most frequent labels to show",
+                                                     statistics_property_,
+                                                     SLOT(updateStatisticsRows()),
+                                                     this);
+        statistics_top_n_property_->setMin(1);
+        statistics_publish_property_ = new BoolProperty("Publish",
+                                                        false,
+                                                        "Publish the top N (label, count) pairs",
+                                                        statistics_property_,
+                                                        SLOT(updateStatisticsTopic()),
+                                                        this);
+        statistics_publish_property_->setDisableChildrenIfFalse(true);
+        statistics_topic_property_ = new StringProperty("Topic",
+                                                        "label_statistics",
+                                                        "Topic on which the label statistics are published",
+                                                        statistics_publish_property_,
+                                                        SLOT(updateStatisticsTopic()),
+                                                        this);
+        statistics_counts_property_ =
+            new Property("Counts", QVariant(), "Most frequent labels in the current cloud", statistics_property_);
+        statistics_counts_property_->setReadOnly(true);
+        updateStatisticsRows();
 
         out_props.push_back(channel_name_property_);
+        out_props.push_back(palette_file_property);
         out_props.push_back(show_only_property_);
+        out_props.push_back(statistics_property_);
+        createCommonProperties(parent_property, out_props);
+        addChannelProperty(channel_name_property_);
+        addChannelProperty(show_only_channel_name_property_);
+
+        updateChannelNames();
     }
 }
 
-void LabelPCTransformer::updateChannels(const sensor_msgs::PointCloud2ConstPtr& cloud)
+// transform() runs for every cloud, so it uses copies of the string properties instead of converting them each time
+void LabelPCTransformer::updateChannelNames()
 {
-    std::vector<std::string> channels;
-    for (const auto& field : cloud->fields)
-    {
-        channels.push_back(field.name);
-    }
-    std::sort(channels.begin(), channels.end());
+    channel_name_ = channel_name_property_->getStdString();
+    show_only_channel_name_ = show_only_channel_name_property_->getStdString();
+    // the value may be followed by the class name of the palette
+    show_only_value_ = std::strtol(show_only_value_property_->getStdString().c_str(), nullptr, 10);
+    Q_EMIT needRetransform();
+}
 
-    if (channels != available_channels_)
+void LabelPCTransformer::updatePaletteOptions()
+{
+    const LabelPalette::ConstPtr palette = palette_file_.palette();
+
+    // offer the class names as show only values, the leading id is what gets compared
+    show_only_value_property_->clearOptions();
+    if (palette)
     {
-        channel_name_property_->clearOptions();
-        show_only_channel_name_property_->clearOptions();
-        for (auto& channel : channels)
+        for (const auto& name : palette->names())
         {
-            if (channel.empty())
-            {
-                continue;
-            }
-            channel_name_property_->addOptionStd(channel);
-            show_only_channel_name_property_->addOptionStd(channel);
+            show_only_value_property_->addOption(
+                QString("%1 %2").arg(name.first).arg(QString::fromStdString(name.second)));
         }
-        available_channels_ = channels;
     }
+    Q_EMIT needRetransform();
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-    uint8_t IntensityLabelPCTransformer::supports(const sensor_msgs::PointCloud2ConstPtr& cloud)
+    IntensityLabelPCTransformer::IntensityLabelPCTransformer() : ColorPCTransformer(false)
     {
-        updateChannels(cloud);
-        return Support_Color;
     }
 
-    bool IntensityLabelPCTransformer::transform(const sensor_msgs::PointCloud2ConstPtr& cloud,
-                                       uint32_t mask,
-                                       const Ogre::Matrix4& transform,
-                                       V_PointCloudPoint& points_out)
+    bool IntensityLabelPCTransformer::colorize(const sensor_msgs::PointCloud2ConstPtr& cloud,
+                                               const std::vector<uint8_t>* outside,
+                                               ColorizedCloud& out)
     {
-        if (!(mask & Support_Color))
+        const int32_t index = findValueChannel(cloud, channel_name_);
+
+        if (index == -1)
         {
             return false;
         }
 
-        int32_t index = findChannelIndex(cloud, channel_name_property_->getStdString());
+        bool show_only_activated = show_only_property_->getBool();
+        float show_only_desired_value = show_only_value_property_->getFloat();
+        int32_t show_only_index = -1;
+        if (show_only_activated)
+        {
+            show_only_index = findChannelIndex(cloud, show_only_channel_name_);
 
-        if (index == -1)
+            if (show_only_index == -1)
+            {
+                return false;
+            }
+        }
+        const uint32_t num_points = cloud->width * cloud->height;
+
+        const bool time = time_property_->getBool();
+        if (time)
         {
-            if (channel_name_property_->getStdString() == "intensity")
+            readTimeField(*cloud,
+                          cloud->fields[index],
+                          static_cast<TimeOrigin>(time_origin_property_->getOptionInt()),
+                          out.times,
+                          out.values);
+        }
+        else
+        {
+            readField(*cloud, cloud->fields[index], out.values);
+        }
+
+        out.colors.resize(num_points);
+        out.hidden.resize(num_points);
+        if (show_only_activated)
+        {
+            readField(*cloud, cloud->fields[show_only_index], out.filter_values);
+            for (uint32_t i = 0; i < num_points; ++i)
             {
-                index = findChannelIndex(cloud, "intensities");
-                if (index == -1)
+                out.hidden[i] = out.filter_values[i] != show_only_desired_value;
+            }
+        }
+        else
+        {
+            std::fill(out.hidden.begin(), out.hidden.end(), 0);
+        }
+        if (outside)
+        {
+            // points outside the region of interest are hidden and excluded from the bounds like filtered ones
+            const uint8_t* outside_ptr = outside->data();
+            for (uint32_t i = 0; i < num_points; ++i)
+            {
+                out.hidden[i] |= outside_ptr[i];
+            }
+        }
+
+        float min_intensity = 999999.0f;
+        float max_intensity = -999999.0f;
+        if (auto_compute_intensity_bounds_property_->getBool())
+        {
+            for (uint32_t i = 0; i < num_points; ++i)
+            {
+                float val = out.values[i];
+                if (!out.hidden[i])
                 {
-                    return false;
+                    min_intensity = std::min(val, min_intensity);
+                    max_intensity = std::max(val, max_intensity);
                 }
             }
-            else
+
+            min_intensity = std::max(-999999.0f, min_intensity);
+            max_intensity = std::min(999999.0f, max_intensity);
             {
-                return false;
+                std::lock_guard<std::mutex> lock(cloud_properties_mutex_);
+                shown_min_intensity_ = min_intensity;
+                shown_max_intensity_ = max_intensity;
             }
+            postCloudProperties();
+        }
+        else
+        {
+            min_intensity = min_intensity_property_->getFloat();
+            max_intensity = max_intensity_property_->getFloat();
         }
 
-        bool show_only_activated = show_only_property_->getBool();
-        float show_only_desired_value = show_only_value_property_->getFloat();
-        uint32_t show_only_index;
-        if (show_only_activated)
+        applyColorMap(static_cast<normalization::Mode>(normalization_property_->getOptionInt()),
+                      gamma_property_->getFloat(),
+                      log_scale_property_->getFloat(),
+                      min_intensity,
+                      max_intensity,
+                      !time && isIntegerField(cloud->fields[index]),
+                      color_maps::getTable(color_map_property_->getOptionInt()),
+                      invert_color_map_property_->getBool(),
+                      min_color_property_->getOgreColor(),
+                      max_color_property_->getOgreColor(),
+                      out);
+
+        return true;
+    }
+
+    void IntensityLabelPCTransformer::createProperties(Property* parent_property, uint32_t mask, QList<Property*>& out_props)
+    {
+
+        if (mask & Support_Color)
         {
-            show_only_index = findChannelIndex(cloud, show_only_channel_name_property_->getStdString());
 
-            if (show_only_index == -1)
+            channel_name_property_ =
+                    new EditableEnumProperty("Channel Name", "intensity",
+                                             "Select the channel to use to compute the intensity", parent_property,
+                                             SLOT(updateChannelNames()), this);
+
+            time_property_ =
+                    new BoolProperty("Time Channel", false,
+                                     "Treat the channel as per point time stamps and colorize by the time offset",
+                                     parent_property, SIGNAL(needRetransform()), this);
+            time_property_->setDisableChildrenIfFalse(true);
+            time_origin_property_ =
+                    new EnumProperty("Time Origin", "Header Stamp",
+                                     "Time the offsets are measured from: the message header stamp, the earliest "
+                                     "point in the cloud, or None if the channel already holds offsets",
+                                     time_property_, SIGNAL(needRetransform()), this);
+            time_origin_property_->addOption("Header Stamp", TIME_ORIGIN_HEADER);
+            time_origin_property_->addOption("Scan Minimum", TIME_ORIGIN_MINIMUM);
+            time_origin_property_->addOption("None", TIME_ORIGIN_NONE);
+
+            normalization_property_ =
+                    new EnumProperty("Normalization", "Linear",
+                                     "Curve mapping the values between the bounds to the colors. Log, Square Root "
+                                     "and Gamma < 1 spread out the low end of heavy tailed channels.",
+                                     parent_property, SLOT(updateNormalization()), this);
+            normalization_property_->addOption("Linear", normalization::LINEAR);
+            normalization_property_->addOption("Log", normalization::LOG);
+            normalization_property_->addOption("Square Root", normalization::SQRT);
+            normalization_property_->addOption("Gamma", normalization::GAMMA);
+            gamma_property_ =
+                    new FloatProperty("Gamma", 0.5, "Exponent of the Gamma normalization",
+                                      normalization_property_, SIGNAL(needRetransform()), this);
+            gamma_property_->setMin(0.01);
+            log_scale_property_ =
+                    new FloatProperty("Log Scale", 100,
+                                      "Scale k of the Log normalization log(1 + k x) / log(1 + k) of the values x "
+                                      "between the bounds. Larger values spread out the low end more.",
+                                      normalization_property_, SIGNAL(needRetransform()), this);
+            log_scale_property_->setMin(0.01);
+
+            color_map_property_ =
+                    new EnumProperty("Color Map", "Rainbow",
+                                     "Color map used to colorize the points, or interpolate between Min and Max Color",
+                                     parent_property, SLOT(updateColorMap()), this);
+            color_map_property_->addOption("Rainbow", color_maps::RAINBOW);
+            color_map_property_->addOption("Turbo", color_maps::TURBO);
+            color_map_property_->addOption("Viridis", color_maps::VIRIDIS);
+            color_map_property_->addOption("Inferno", color_maps::INFERNO);
+            color_map_property_->addOption("Cyclic", color_maps::CYCLIC);
+            color_map_property_->addOption("Min/Max Color", color_maps::MIN_MAX_COLOR);
+            invert_color_map_property_ =
+                    new BoolProperty("Invert Color Map", false, "Whether to invert the color map", parent_property,
+                                     SIGNAL(needRetransform()), this);
+
+            // "Use rainbow" and "Invert Rainbow" were replaced by the color map selection. They are kept hidden and
+            // unsaved so configs written before still load with the same colors.
+            legacy_use_rainbow_property_ =
+                    new BoolProperty("Use rainbow", true, "Replaced by Color Map", parent_property,
+                                     SLOT(migrateLegacyColorMap()), this);
+            legacy_use_rainbow_property_->setHidden(true);
+            legacy_use_rainbow_property_->setShouldBeSaved(false);
+            legacy_invert_rainbow_property_ =
+                    new BoolProperty("Invert Rainbow", false, "Replaced by Invert Color Map", parent_property,
+                                     SLOT(migrateLegacyColorMap()), this);
+            legacy_invert_rainbow_property_->setHidden(true);
+            legacy_invert_rainbow_property_->setShouldBeSaved(false);
+
+            min_color_property_ =
+                    new ColorProperty("Min Color", Qt::black,
+                                      "Color to assign the points with the minimum intensity.  "
+                                      "Actual color is interpolated between this and Max Color.",
+                                      parent_property,
+                                      SIGNAL(needRetransform()), this);
+
+            max_color_property_ =
+                    new ColorProperty("Max Color", Qt::white,
+                                      "Color to assign the points with the maximum intensity.  "
+                                      "Actual color is interpolated between this and Min Color.",
+                                      parent_property,
+                                      SIGNAL(needRetransform()), this);
+
+            auto_compute_intensity_bounds_property_ =
+                    new BoolProperty("Autocompute Intensity Bounds", true,
+                                     "Whether to automatically compute the intensity min/max values.",
+                                     parent_property, SLOT(updateAutoComputeIntensityBounds()),
+                                     this);
+
+            min_intensity_property_ = new FloatProperty(
+                    "Min Intensity", 0,
+                    "Minimum possible intensity value, used to interpolate from Min Color to Max Color for a point.",
+                    parent_property);
+
+            max_intensity_property_ = new FloatProperty(
+                    "Max Intensity", 4096,
+                    "Maximum possible intensity value, used to interpolate from Min Color to Max Color for a point.",
+                    parent_property);
+
+
+            show_only_property_ = new BoolProperty(
+                    "Show only", false, "Show only points with value", parent_property, SIGNAL(needRetransform()), this);
+            show_only_property_->setDisableChildrenIfFalse(true);
+            show_only_channel_name_property_ = new EditableEnumProperty("Channel Name",
+                                                                        "sem_label",
+                                                                        "Select the channel by which to hide",
+                                                                        show_only_property_,
+                                                                        SLOT(updateChannelNames()),
+                                                                        this);
+            show_only_value_property_ =
+                    new FloatProperty("Equal To", 0, "Select the value", show_only_property_, SIGNAL(needRetransform()), this);
+
+            out_props.push_back(channel_name_property_);
+            out_props.push_back(time_property_);
+            out_props.push_back(normalization_property_);
+            out_props.push_back(color_map_property_);
+            out_props.push_back(invert_color_map_property_);
+            out_props.push_back(min_color_property_);
+            out_props.push_back(max_color_property_);
+            out_props.push_back(auto_compute_intensity_bounds_property_);
+            out_props.push_back(min_intensity_property_);
+            out_props.push_back(max_intensity_property_);
+            out_props.push_back(show_only_property_);
+            createCommonProperties(parent_property, out_props);
+            addChannelProperty(channel_name_property_);
+            addChannelProperty(show_only_channel_name_property_);
+
+            updateColorMap();
+            updateNormalization();
+            updateAutoComputeIntensityBounds();
+            updateChannelNames();
+        }
+    }
+
+    void IntensityLabelPCTransformer::updateCloudProperties()
+    {
+        // values entered by the user while a cloud was colorized must not be overwritten
+        if (!auto_compute_intensity_bounds_property_->getBool())
+        {
+            return;
+        }
+        float min_intensity, max_intensity;
+        {
+            std::lock_guard<std::mutex> lock(cloud_properties_mutex_);
+            min_intensity = shown_min_intensity_;
+            max_intensity = shown_max_intensity_;
+        }
+        min_intensity_property_->setFloat(min_intensity);
+        max_intensity_property_->setFloat(max_intensity);
+    }
+
+    void IntensityLabelPCTransformer::updateAutoComputeIntensityBounds()
+    {
+        bool auto_compute = auto_compute_intensity_bounds_property_->getBool();
+        min_intensity_property_->setReadOnly(auto_compute);
+        max_intensity_property_->setReadOnly(auto_compute);
+        if (auto_compute)
+        {
+            disconnect(min_intensity_property_, &Property::changed, this,
+                       &IntensityLabelPCTransformer::needRetransform);
+            disconnect(max_intensity_property_, &Property::changed, this,
+                       &IntensityLabelPCTransformer::needRetransform);
+        }
+        else
+        {
+            connect(min_intensity_property_, &Property::changed, this,
+                    &IntensityLabelPCTransformer::needRetransform);
+            connect(max_intensity_property_, &Property::changed, this,
+                    &IntensityLabelPCTransformer::needRetransform);
+        }
+        Q_EMIT needRetransform();
+    }
+
+    // transform() runs for every cloud, so it uses copies of the string properties instead of converting them each time
+    void IntensityLabelPCTransformer::updateChannelNames()
+    {
+        channel_name_ = channel_name_property_->getStdString();
+        show_only_channel_name_ = show_only_channel_name_property_->getStdString();
+        Q_EMIT needRetransform();
+    }
+
+    void IntensityLabelPCTransformer::updateColorMap()
+    {
+        bool use_min_max_color = color_map_property_->getOptionInt() == color_maps::MIN_MAX_COLOR;
+        invert_color_map_property_->setHidden(use_min_max_color);
+        min_color_property_->setHidden(!use_min_max_color);
+        max_color_property_->setHidden(!use_min_max_color);
+        Q_EMIT needRetransform();
+    }
+
+    void IntensityLabelPCTransformer::migrateLegacyColorMap()
+    {
+        // only called when an old config sets one of the legacy keys, "Use rainbow" false meant Min/Max Color
+        if (!legacy_use_rainbow_property_->getBool())
+        {
+            color_map_property_->setValue("Min/Max Color");
+        }
+        else if (color_map_property_->getOptionInt() == color_maps::MIN_MAX_COLOR)
+        {
+            color_map_property_->setValue("Rainbow");
+        }
+        invert_color_map_property_->setBool(legacy_invert_rainbow_property_->getBool());
+    }
+
+    void IntensityLabelPCTransformer::updateNormalization()
+    {
+        gamma_property_->setHidden(normalization_property_->getOptionInt() != normalization::GAMMA);
+        log_scale_property_->setHidden(normalization_property_->getOptionInt() != normalization::LOG);
+        Q_EMIT needRetransform();
+    }
+
+// ----------------------------------------------------------------------------------------------------
+
+    RangePCTransformer::RangePCTransformer() : ColorPCTransformer(false)
+    {
+    }
+
+    RangePCTransformer::ChannelStatistics* RangePCTransformer::findStatistics(
+            const sensor_msgs::PointCloud2ConstPtr& cloud)
+    {
+        const bool use_continuous_int = use_permanent_intensity_property_->getBool();
+        if (continuous_int_switched != use_continuous_int)
+        {
+            channel_statistics_.clear();
+            continuous_int_switched = use_continuous_int;
+        }
+
+        const int32_t index = findValueChannel(cloud, channel_name_);
+        if (index == -1)
+        {
+            return nullptr;
+        }
+
+        // the persistent statistics are kept per channel name, so switching between channels or a reordered schema
+        // continue with the bounds learned for that channel. The key is built in a reused string and only inserted
+        // for channels seen the first time.
+        statistics_key_.assign(cloud->fields[index].name);
+        if (time_property_->getBool())
+        {
+            statistics_key_.append(" (time)");
+        }
+        auto statistics_it = channel_statistics_.find(statistics_key_);
+        if (statistics_it == channel_statistics_.end())
+        {
+            statistics_it = channel_statistics_.emplace(statistics_key_, ChannelStatistics()).first;
+        }
+        return &statistics_it->second;
+    }
+
+    bool RangePCTransformer::colorize(const sensor_msgs::PointCloud2ConstPtr& cloud,
+                                      const std::vector<uint8_t>* outside,
+                                      ColorizedCloud& out)
+    {
+        const int32_t index = findValueChannel(cloud, channel_name_);
+        ChannelStatistics* statistics = findStatistics(cloud);
+
+        if (index == -1 || !statistics)
+        {
+            return false;
+        }
+
+        bool filter_activated = filter_property_->getBool();
+        bool invert_filter_activated = invert_filter_property_->getBool();
+        float lower_desired_value = filter_lower_value_property_->getFloat();
+        float upper_desired_value = filter_upper_value_property_->getFloat();
+        int32_t range_filter_index = -1;
+        if (filter_activated)
+        {
+            range_filter_index = findChannelIndex(cloud, filter_channel_name_);
+
+            if (range_filter_index == -1)
             {
                 return false;
             }
+            readField(*cloud, cloud->fields[range_filter_index], out.filter_values);
+        }
+        const uint32_t num_points = cloud->width * cloud->height;
+
+        const bool time = time_property_->getBool();
+        if (time)
+        {
+            readTimeField(*cloud,
+                          cloud->fields[index],
+                          static_cast<TimeOrigin>(time_origin_property_->getOptionInt()),
+                          out.times,
+                          out.values);
+        }
+        else
+        {
+            readField(*cloud, cloud->fields[index], out.values);
+        }
+
+        // points outside the region of interest are hidden and excluded from the bounds like filtered ones
+        out.colors.resize(num_points);
+        out.hidden.resize(num_points);
+        for (uint32_t i = 0; i < num_points; ++i)
+        {
+            out.hidden[i] = (filter_activated && !test_value(out.filter_values[i], lower_desired_value,
+                                                             upper_desired_value, invert_filter_activated)) ||
+                            (outside && (*outside)[i]);
         }
-        const uint32_t offset = cloud->fields[index].offset;
-        const uint8_t type = cloud->fields[index].datatype;
-        const uint32_t point_step = cloud->point_step;
-        const uint32_t num_points = cloud->width * cloud->height;
 
         float min_intensity = 999999.0f;
         float max_intensity = -999999.0f;
         if (auto_compute_intensity_bounds_property_->getBool())
         {
+            // moments of this cloud as sums of offsets to a shift, which keeps them numerically stable
+            double shift = statistics->count > 0 ? statistics->mean : (num_points > 0 ? out.values[0] : 0.0);
+            if (!std::isfinite(shift))
+            {
+                shift = 0.0;
+            }
+            uint64_t count = 0;
+            double sum = 0.0;
+            double sum_sq = 0.0;
+
             for (uint32_t i = 0; i < num_points; ++i)
             {
-                float val = valueFromCloud<float>(cloud, offset, type, point_step, i);
-                if (!show_only_activated)
+                float val = out.values[i];
+                if (out.hidden[i])
                 {
-                    min_intensity = std::min(val, min_intensity);
-                    max_intensity = std::max(val, max_intensity);
+                    continue;
                 }
-                else
+                min_intensity = std::min(val, min_intensity);
+                max_intensity = std::max(val, max_intensity);
+                if (std::isfinite(val))
                 {
-                    const uint32_t show_only_offset = cloud->fields[show_only_index].offset;
-                    const uint8_t show_only_type = cloud->fields[show_only_index].datatype;
-                    auto show_only_val = valueFromCloud<float>(cloud, show_only_offset, show_only_type, point_step, i);
-                    if(show_only_val == show_only_desired_value)
-                    {
-                        min_intensity = std::min(val, min_intensity);
-                        max_intensity = std::max(val, max_intensity);
-                    }
+                    const double offset = val - shift;
+                    ++count;
+                    sum += offset;
+                    sum_sq += offset * offset;
                 }
             }
 
             min_intensity = std::max(-999999.0f, min_intensity);
             max_intensity = std::min(999999.0f, max_intensity);
-            min_intensity_property_->setFloat(min_intensity);
-            max_intensity_property_->setFloat(max_intensity);
+            if (use_permanent_intensity_property_->getBool())
+            {
+                statistics->merge(min_intensity, max_intensity, count, shift, sum, sum_sq);
+                min_intensity = statistics->min;
+                max_intensity = statistics->max;
+            }
+            {
+                std::lock_guard<std::mutex> lock(cloud_properties_mutex_);
+                shown_min_intensity_ = min_intensity;
+                shown_max_intensity_ = max_intensity;
+                shown_mean_ = statistics->mean;
+                shown_std_dev_ = std::sqrt(statistics->variance());
+            }
+            postCloudProperties();
         }
         else
         {
@@ -249,86 +1063,46 @@ void LabelPCTransformer::updateChannels(const sensor_msgs::PointCloud2ConstPtr&
             max_intensity = max_intensity_property_->getFloat();
         }
 
-        float diff_intensity = max_intensity - min_intensity;
-        if (diff_intensity == 0)
-        {
-            // If min and max are equal, set the diff to something huge so
-            // when we divide by it, we effectively get zero.  That way the
-            // point cloud coloring will be predictably uniform when min and
-            // max are equal.
-            diff_intensity = 1e20;
-        }
-        Ogre::ColourValue max_color = max_color_property_->getOgreColor();
-        Ogre::ColourValue min_color = min_color_property_->getOgreColor();
-
-        if (use_rainbow_property_->getBool())
-        {
-            for (uint32_t i = 0; i < num_points; ++i)
-            {
-                float val = valueFromCloud<float>(cloud, offset, type, point_step, i);
-                float value = 1.0 - (val - min_intensity) / diff_intensity;
-                if (invert_rainbow_property_->getBool())
-                {
-                    value = 1.0 - value;
-                }
-                getRainbowColorLabel(value, points_out[i].color);
-
-                if (show_only_activated)
-                {
-                    const uint32_t show_only_offset = cloud->fields[show_only_index].offset;
-                    const uint8_t show_only_type = cloud->fields[show_only_index].datatype;
-                    auto show_only_val = valueFromCloud<float>(cloud, show_only_offset, show_only_type, point_step, i);
-                    if(show_only_val != show_only_desired_value)
-                    {
-                        points_out[i].color.a = 0.f;
-                        // put those points to origin in order to not accidentally select them with the selection tool
-                        points_out[i].position.x = 0.f;
-                        points_out[i].position.y = 0.f;
-                        points_out[i].position.z = 0.f;
-                    }
-                }
-            }
-        }
-        else
-        {
-            for (uint32_t i = 0; i < num_points; ++i)
-            {
-                float val = valueFromCloud<float>(cloud, offset, type, point_step, i);
-                float normalized_intensity = (val - min_intensity) / diff_intensity;
-                normalized_intensity = std::min(1.0f, std::max(0.0f, normalized_intensity));
-                points_out[i].color.r =
-                        max_color.r * normalized_intensity + min_color.r * (1.0f - normalized_intensity);
-                points_out[i].color.g =
-                        max_color.g * normalized_intensity + min_color.g * (1.0f - normalized_intensity);
-                points_out[i].color.b =
-                        max_color.b * normalized_intensity + min_color.b * (1.0f - normalized_intensity);
-
-                if (show_only_activated)
-                {
-                    const uint32_t show_only_offset = cloud->fields[show_only_index].offset;
-                    const uint8_t show_only_type = cloud->fields[show_only_index].datatype;
-                    auto show_only_val = valueFromCloud<float>(cloud, show_only_offset, show_only_type, point_step, i);
-                    if(show_only_val != show_only_desired_value)
-                    {
-                        points_out[i].color.a = 0.f;
-                        // put those points to origin in order to not accidentally select them with the selection tool
-                        points_out[i].position.x = 0.f;
-                        points_out[i].position.y = 0.f;
-                        points_out[i].position.z = 0.f;
-                    }
-                }
-            }
-        }
+        applyColorMap(static_cast<normalization::Mode>(normalization_property_->getOptionInt()),
+                      gamma_property_->getFloat(),
+                      log_scale_property_->getFloat(),
+                      min_intensity,
+                      max_intensity,
+                      !time && isIntegerField(cloud->fields[index]),
+                      color_maps::getTable(color_map_property_->getOptionInt()),
+                      invert_color_map_property_->getBool(),
+                      min_color_property_->getOgreColor(),
+                      max_color_property_->getOgreColor(),
+                      out);
 
         return true;
     }
 
-    uint8_t IntensityLabelPCTransformer::score(const sensor_msgs::PointCloud2ConstPtr& cloud)
+    void RangePCTransformer::ChannelStatistics::merge(float cloud_min,
+                                                      float cloud_max,
+                                                      uint64_t cloud_count,
+                                                      double shift,
+                                                      double sum,
+                                                      double sum_sq)
     {
-        return 255;
+        min = std::min(cloud_min, min);
+        max = std::max(cloud_max, max);
+        if (cloud_count == 0)
+        {
+            return;
+        }
+
+        // parallel variance update (Chan et al.) of the running moments with the moments of the cloud
+        const double cloud_mean = shift + sum / cloud_count;
+        const double cloud_m2 = std::max(0.0, sum_sq - sum * sum / cloud_count);
+        const double delta = cloud_mean - mean;
+        const uint64_t total = count + cloud_count;
+        mean += delta * cloud_count / total;
+        m2 += cloud_m2 + delta * delta * count * cloud_count / total;
+        count = total;
     }
 
-    void IntensityLabelPCTransformer::createProperties(Property* parent_property, uint32_t mask, QList<Property*>& out_props)
+    void RangePCTransformer::createProperties(Property* parent_property, uint32_t mask, QList<Property*>& out_props)
     {
 
         if (mask & Support_Color)
@@ -337,15 +1111,68 @@ void LabelPCTransformer::updateChannels(const sensor_msgs::PointCloud2ConstPtr&
             channel_name_property_ =
                     new EditableEnumProperty("Channel Name", "intensity",
                                              "Select the channel to use to compute the intensity", parent_property,
-                                             SIGNAL(needRetransform()), this);
-
-            use_rainbow_property_ =
-                    new BoolProperty("Use rainbow", true,
-                                     "Whether to use a rainbow of colors or interpolate between two",
-                                     parent_property, SLOT(updateUseRainbow()), this);
-            invert_rainbow_property_ =
-                    new BoolProperty("Invert Rainbow", false, "Whether to invert rainbow colors", parent_property,
-                                     SLOT(updateUseRainbow()), this);
+                                             SLOT(updateChannelNames()), this);
+
+            time_property_ =
+                    new BoolProperty("Time Channel", false,
+                                     "Treat the channel as per point time stamps and colorize by the time offset",
+                                     parent_property, SIGNAL(needRetransform()), this);
+            time_property_->setDisableChildrenIfFalse(true);
+            time_origin_property_ =
+                    new EnumProperty("Time Origin", "Header Stamp",
+                                     "Time the offsets are measured from: the message header stamp, the earliest "
+                                     "point in the cloud, or None if the channel already holds offsets",
+                                     time_property_, SIGNAL(needRetransform()), this);
+            time_origin_property_->addOption("Header Stamp", TIME_ORIGIN_HEADER);
+            time_origin_property_->addOption("Scan Minimum", TIME_ORIGIN_MINIMUM);
+            time_origin_property_->addOption("None", TIME_ORIGIN_NONE);
+
+            normalization_property_ =
+                    new EnumProperty("Normalization", "Linear",
+                                     "Curve mapping the values between the bounds to the colors. Log, Square Root "
+                                     "and Gamma < 1 spread out the low end of heavy tailed channels.",
+                                     parent_property, SLOT(updateNormalization()), this);
+            normalization_property_->addOption("Linear", normalization::LINEAR);
+            normalization_property_->addOption("Log", normalization::LOG);
+            normalization_property_->addOption("Square Root", normalization::SQRT);
+            normalization_property_->addOption("Gamma", normalization::GAMMA);
+            gamma_property_ =
+                    new FloatProperty("Gamma", 0.5, "Exponent of the Gamma normalization",
+                                      normalization_property_, SIGNAL(needRetransform()), this);
+            gamma_property_->setMin(0.01);
+            log_scale_property_ =
+                    new FloatProperty("Log Scale", 100,
+                                      "Scale k of the Log normalization log(1 + k x) / log(1 + k) of the values x "
+                                      "between the bounds. Larger values spread out the low end more.",
+                                      normalization_property_, SIGNAL(needRetransform()), this);
+            log_scale_property_->setMin(0.01);
+
+            color_map_property_ =
+                    new EnumProperty("Color Map", "Rainbow",
+                                     "Color map used to colorize the points, or interpolate between Min and Max Color",
+                                     parent_property, SLOT(updateColorMap()), this);
+            color_map_property_->addOption("Rainbow", color_maps::RAINBOW);
+            color_map_property_->addOption("Turbo", color_maps::TURBO);
+            color_map_property_->addOption("Viridis", color_maps::VIRIDIS);
+            color_map_property_->addOption("Inferno", color_maps::INFERNO);
+            color_map_property_->addOption("Cyclic", color_maps::CYCLIC);
+            color_map_property_->addOption("Min/Max Color", color_maps::MIN_MAX_COLOR);
+            invert_color_map_property_ =
+                    new BoolProperty("Invert Color Map", false, "Whether to invert the color map", parent_property,
+                                     SIGNAL(needRetransform()), this);
+
+            // "Use rainbow" and "Invert Rainbow" were replaced by the color map selection. They are kept hidden and
+            // unsaved so configs written before still load with the same colors.
+            legacy_use_rainbow_property_ =
+                    new BoolProperty("Use rainbow", true, "Replaced by Color Map", parent_property,
+                                     SLOT(migrateLegacyColorMap()), this);
+            legacy_use_rainbow_property_->setHidden(true);
+            legacy_use_rainbow_property_->setShouldBeSaved(false);
+            legacy_invert_rainbow_property_ =
+                    new BoolProperty("Invert Rainbow", false, "Replaced by Invert Color Map", parent_property,
+                                     SLOT(migrateLegacyColorMap()), this);
+            legacy_invert_rainbow_property_->setHidden(true);
+            legacy_invert_rainbow_property_->setShouldBeSaved(false);
 
             min_color_property_ =
                     new ColorProperty("Min Color", Qt::black,
@@ -378,65 +1205,83 @@ void LabelPCTransformer::updateChannels(const sensor_msgs::PointCloud2ConstPtr&
                     parent_property);
 
 
-            show_only_property_ = new BoolProperty(
-                    "Show only", false, "Show only points with value", parent_property, SIGNAL(needRetransform()), this);
-            show_only_property_->setDisableChildrenIfFalse(true);
-            show_only_channel_name_property_ = new EditableEnumProperty("Channel Name",
+            filter_property_ = new BoolProperty(
+                    "Filter range", false, "Show only points in or out of given range", parent_property, SIGNAL(needRetransform()), this);
+            filter_property_->setDisableChildrenIfFalse(true);
+            filter_channel_name_property_ = new EditableEnumProperty("Channel Name",
                                                                         "sem_label",
                                                                         "Select the channel by which to hide",
-                                                                        show_only_property_,
-                                                                        SIGNAL(needRetransform()),
+                                                                     filter_property_,
+                                                                        SLOT(updateChannelNames()),
                                                                         this);
-            show_only_value_property_ =
-                    new FloatProperty("Equal To", 0, "Select the value", show_only_property_, SIGNAL(needRetransform()), this);
+            filter_lower_value_property_ =
+                    new FloatProperty("Lower Limit", 0, "Select the value", filter_property_, SIGNAL(needRetransform()), this);
+            filter_upper_value_property_ =
+                    new FloatProperty("Upper Limit", 0, "Select the value", filter_property_, SIGNAL(needRetransform()), this);
+
+            invert_filter_property_ = new BoolProperty(
+                    "Invert Filter", false, "Show only points outside of given range", filter_property_, SIGNAL(needRetransform()), this);
 
+            use_permanent_intensity_property_ =
+                    new BoolProperty("Persistent Intensity values", true,
+                                     "Whether to keep min/max intensity values across point clouds. "
+                                     "The values are kept separately for each channel.",
+                                     parent_property);
+            mean_property_ = new FloatProperty("Mean", 0, "Mean of the channel over all point clouds.",
+                                               use_permanent_intensity_property_);
+            mean_property_->setReadOnly(true);
+            std_dev_property_ = new FloatProperty("Std Dev", 0, "Standard deviation of the channel over all point clouds.",
+                                                  use_permanent_intensity_property_);
+            std_dev_property_->setReadOnly(true);
 
             out_props.push_back(channel_name_property_);
-            out_props.push_back(use_rainbow_property_);
-            out_props.push_back(invert_rainbow_property_);
+            out_props.push_back(time_property_);
+            out_props.push_back(normalization_property_);
+            out_props.push_back(color_map_property_);
+            out_props.push_back(invert_color_map_property_);
             out_props.push_back(min_color_property_);
             out_props.push_back(max_color_property_);
             out_props.push_back(auto_compute_intensity_bounds_property_);
+            out_props.push_back(use_permanent_intensity_property_);
             out_props.push_back(min_intensity_property_);
             out_props.push_back(max_intensity_property_);
-            out_props.push_back(show_only_property_);
-
-                updateUseRainbow();
-                updateAutoComputeIntensityBounds();
-
-
-
+            out_props.push_back(filter_property_);
+            createCommonProperties(parent_property, out_props);
+            addChannelProperty(channel_name_property_);
+            addChannelProperty(filter_channel_name_property_);
 
+            updateColorMap();
+            updateNormalization();
+            updateAutoComputeIntensityBounds();
+            updateChannelNames();
         }
     }
 
-    void IntensityLabelPCTransformer::updateChannels(const sensor_msgs::PointCloud2ConstPtr& cloud)
+    void RangePCTransformer::updateCloudProperties()
     {
-        std::vector<std::string> channels;
-        for (const auto& field : cloud->fields)
+        // values entered by the user while a cloud was colorized must not be overwritten
+        if (!auto_compute_intensity_bounds_property_->getBool())
         {
-            channels.push_back(field.name);
+            return;
         }
-        std::sort(channels.begin(), channels.end());
-
-        if (channels != available_channels_)
+        float min_intensity, max_intensity, mean, std_dev;
         {
-            channel_name_property_->clearOptions();
-            show_only_channel_name_property_->clearOptions();
-            for (auto& channel : channels)
-            {
-                if (channel.empty())
-                {
-                    continue;
-                }
-                channel_name_property_->addOptionStd(channel);
-                show_only_channel_name_property_->addOptionStd(channel);
-            }
-            available_channels_ = channels;
+            std::lock_guard<std::mutex> lock(cloud_properties_mutex_);
+            min_intensity = shown_min_intensity_;
+            max_intensity = shown_max_intensity_;
+            mean = shown_mean_;
+            std_dev = shown_std_dev_;
+        }
+        min_intensity_property_->setFloat(min_intensity);
+        max_intensity_property_->setFloat(max_intensity);
+        if (use_permanent_intensity_property_->getBool())
+        {
+            mean_property_->setFloat(mean);
+            std_dev_property_->setFloat(std_dev);
         }
     }
 
-    void IntensityLabelPCTransformer::updateAutoComputeIntensityBounds()
+    void RangePCTransformer::updateAutoComputeIntensityBounds()
     {
         bool auto_compute = auto_compute_intensity_bounds_property_->getBool();
         min_intensity_property_->setReadOnly(auto_compute);
@@ -444,180 +1289,146 @@ void LabelPCTransformer::updateChannels(const sensor_msgs::PointCloud2ConstPtr&
         if (auto_compute)
         {
             disconnect(min_intensity_property_, &Property::changed, this,
-                       &IntensityLabelPCTransformer::needRetransform);
+                       &RangePCTransformer::needRetransform);
             disconnect(max_intensity_property_, &Property::changed, this,
-                       &IntensityLabelPCTransformer::needRetransform);
+                       &RangePCTransformer::needRetransform);
         }
         else
         {
             connect(min_intensity_property_, &Property::changed, this,
-                    &IntensityLabelPCTransformer::needRetransform);
+                    &RangePCTransformer::needRetransform);
             connect(max_intensity_property_, &Property::changed, this,
-                    &IntensityLabelPCTransformer::needRetransform);
+                    &RangePCTransformer::needRetransform);
         }
         Q_EMIT needRetransform();
     }
 
-    void IntensityLabelPCTransformer::updateUseRainbow()
+    void RangePCTransformer::updateChannelNames()
     {
-        bool use_rainbow = use_rainbow_property_->getBool();
-        invert_rainbow_property_->setHidden(!use_rainbow);
-        min_color_property_->setHidden(use_rainbow);
-        max_color_property_->setHidden(use_rainbow);
+        channel_name_ = channel_name_property_->getStdString();
+        filter_channel_name_ = filter_channel_name_property_->getStdString();
         Q_EMIT needRetransform();
     }
 
-// ----------------------------------------------------------------------------------------------------
-
-    uint8_t RangePCTransformer::supports(const sensor_msgs::PointCloud2ConstPtr& cloud)
+    void RangePCTransformer::updateColorMap()
     {
-        updateChannels(cloud);
-        return Support_Color;
+        bool use_min_max_color = color_map_property_->getOptionInt() == color_maps::MIN_MAX_COLOR;
+        invert_color_map_property_->setHidden(use_min_max_color);
+        min_color_property_->setHidden(!use_min_max_color);
+        max_color_property_->setHidden(!use_min_max_color);
+        Q_EMIT needRetransform();
     }
 
-    bool RangePCTransformer::transform(const sensor_msgs::PointCloud2ConstPtr& cloud,
-                                                uint32_t mask,
-                                                const Ogre::Matrix4& transform,
-                                                V_PointCloudPoint& points_out)
+    void RangePCTransformer::migrateLegacyColorMap()
     {
-        if (!(mask & Support_Color))
+        // only called when an old config sets one of the legacy keys, "Use rainbow" false meant Min/Max Color
+        if (!legacy_use_rainbow_property_->getBool())
         {
-            return false;
+            color_map_property_->setValue("Min/Max Color");
+        }
+        else if (color_map_property_->getOptionInt() == color_maps::MIN_MAX_COLOR)
+        {
+            color_map_property_->setValue("Rainbow");
         }
+        invert_color_map_property_->setBool(legacy_invert_rainbow_property_->getBool());
+    }
+
+    void RangePCTransformer::updateNormalization()
+    {
+        gamma_property_->setHidden(normalization_property_->getOptionInt() != normalization::GAMMA);
+        log_scale_property_->setHidden(normalization_property_->getOptionInt() != normalization::LOG);
+        Q_EMIT needRetransform();
+    }
+
+// ----------------------------------------------------------------------------------------------------
 
-        int32_t index = findChannelIndex(cloud, channel_name_property_->getStdString());
+    LabelIntensityPCTransformer::LabelIntensityPCTransformer() : ColorPCTransformer(true)
+    {
+    }
+
+    bool LabelIntensityPCTransformer::colorize(const sensor_msgs::PointCloud2ConstPtr& cloud,
+                                               const std::vector<uint8_t>* outside,
+                                               ColorizedCloud& out)
+    {
+        int32_t index = findChannelIndex(cloud, channel_name_);
 
         if (index == -1)
         {
-            if (channel_name_property_->getStdString() == "intensity")
-            {
-                index = findChannelIndex(cloud, "intensities");
-                if (index == -1)
-                {
-                    return false;
-                }
-            }
-            else
-            {
-                return false;
-            }
+            return false;
         }
 
-        //index changed?
-        if(index!=selected_chanel)
+        const int32_t intensity_index = findValueChannel(cloud, intensity_channel_name_);
+
+        if (intensity_index == -1)
         {
-            // reset min max continuous intensities
-            continuous_min_intensity = 999999.0f;
-            continuous_max_intensity = -999999.0f;
-            selected_chanel = index;
+            return false;
         }
 
-
-        bool filter_activated = filter_property_->getBool();
-        bool invert_filter_activated = invert_filter_property_->getBool();
-        float lower_desired_value = filter_lower_value_property_->getFloat();
-        float upper_desired_value = filter_upper_value_property_->getFloat();
-        uint32_t range_filter_index;
-        if (filter_activated)
+        bool show_only_activated = show_only_property_->getBool();
+        uint16_t show_only_desired_value = show_only_value_property_->getInt();
+        int32_t show_only_index = -1;
+        if (show_only_activated)
         {
-            range_filter_index = findChannelIndex(cloud, filter_channel_name_property_->getStdString());
+            show_only_index = findChannelIndex(cloud, show_only_channel_name_);
 
-            if (range_filter_index == -1)
+            if (show_only_index == -1)
             {
                 return false;
             }
         }
-        const uint32_t offset = cloud->fields[index].offset;
-        const uint8_t type = cloud->fields[index].datatype;
-        const uint32_t point_step = cloud->point_step;
         const uint32_t num_points = cloud->width * cloud->height;
 
-        const bool use_continuous_int = use_permanent_intensity_property_->getBool();
-        if (continuous_int_switched != use_continuous_int)
+        readField(*cloud, cloud->fields[index], out.labels);
+        readField(*cloud, cloud->fields[intensity_index], out.values);
+        if (show_only_activated)
         {
-            continuous_min_intensity = 999999.0f;
-            continuous_max_intensity = -999999.0f;
-            continuous_int_switched = use_continuous_int;
+            readField(*cloud, cloud->fields[show_only_index], out.filter_labels);
+        }
+
+        // the palette may be swapped by a reload at any time, the copy keeps the current one for the whole cloud
+        const LabelPalette::ConstPtr palette = palette_file_.palette();
+
+        // points outside the region of interest are hidden and excluded from the bounds like filtered ones. An
+        // explicit show only value overrides the default visibility of the palette.
+        out.colors.resize(num_points);
+        out.hidden.resize(num_points);
+        for (uint32_t i = 0; i < num_points; ++i)
+        {
+            bool hidden = palette && !palette->visible(out.labels[i]);
+            if (show_only_activated)
+            {
+                hidden = out.filter_labels[i] != show_only_desired_value;
+            }
+            out.hidden[i] = hidden || (outside && (*outside)[i]);
         }
 
-        float transient_min_intensity = 999999.0f;
-        float transient_max_intensity = -999999.0f;
+        float min_intensity = 999999.0f;
+        float max_intensity = -999999.0f;
         if (auto_compute_intensity_bounds_property_->getBool())
         {
             for (uint32_t i = 0; i < num_points; ++i)
             {
-                float val = valueFromCloud<float>(cloud, offset, type, point_step, i);
-                if (!filter_activated)
-                {
-                    if(use_continuous_int)
-                    {
-                        continuous_min_intensity = std::min(val, continuous_min_intensity);
-                        continuous_max_intensity = std::max(val, continuous_max_intensity);
-                    }
-                    else
-                    {
-                        transient_min_intensity = std::min(val, transient_min_intensity);
-                        transient_max_intensity = std::max(val, transient_max_intensity);
-                    }
-                }
-                else
+                float val = out.values[i];
+                if (!out.hidden[i])
                 {
-                    const uint32_t filter_offset = cloud->fields[range_filter_index].offset;
-                    const uint8_t filter_type = cloud->fields[range_filter_index].datatype;
-                    auto filter_val = valueFromCloud<float>(cloud, filter_offset, filter_type, point_step, i);
-                    if(test_value(filter_val,lower_desired_value,upper_desired_value,invert_filter_activated))
-                    {
-                        if(use_continuous_int)
-                        {
-                            continuous_min_intensity = std::min(val, continuous_min_intensity);
-                            continuous_max_intensity = std::max(val, continuous_max_intensity);
-                        }
-                        else
-                        {
-                            transient_min_intensity = std::min(val, transient_min_intensity);
-                            transient_max_intensity = std::max(val, transient_max_intensity);
-                        }
-                    }
+                    min_intensity = std::min(val, min_intensity);
+                    max_intensity = std::max(val, max_intensity);
                 }
             }
 
-            if(use_continuous_int)
-            {
-                continuous_min_intensity = std::max(-999999.0f, continuous_min_intensity);
-                continuous_max_intensity = std::min(999999.0f, continuous_max_intensity);
-                min_intensity_property_->setFloat(continuous_min_intensity);
-                max_intensity_property_->setFloat(continuous_max_intensity);
-            }
-            else
+            min_intensity = std::max(-999999.0f, min_intensity);
+            max_intensity = std::min(999999.0f, max_intensity);
             {
-                transient_min_intensity = std::max(-999999.0f, transient_min_intensity);
-                transient_max_intensity = std::min(999999.0f, transient_max_intensity);
-                min_intensity_property_->setFloat(transient_min_intensity);
-                max_intensity_property_->setFloat(transient_max_intensity);
+                std::lock_guard<std::mutex> lock(cloud_properties_mutex_);
+                shown_min_intensity_ = min_intensity;
+                shown_max_intensity_ = max_intensity;
             }
+            postCloudProperties();
         }
         else
         {
-            transient_min_intensity = min_intensity_property_->getFloat();
-            transient_max_intensity = max_intensity_property_->getFloat();
-            continuous_min_intensity = transient_min_intensity;
-            continuous_max_intensity = transient_max_intensity;
-        }
-
-        float min_intensity ;
-        float max_intensity ;
-
-        if(!use_continuous_int)
-        {
-            min_intensity = transient_min_intensity;
-            max_intensity = transient_max_intensity;
-
-        }
-        else
-        {
-            min_intensity = continuous_min_intensity;
-            max_intensity = continuous_max_intensity;
-
+            min_intensity = min_intensity_property_->getFloat();
+            max_intensity = max_intensity_property_->getFloat();
         }
 
         float diff_intensity = max_intensity - min_intensity;
@@ -629,108 +1440,75 @@ void LabelPCTransformer::updateChannels(const sensor_msgs::PointCloud2ConstPtr&
             // max are equal.
             diff_intensity = 1e20;
         }
-        Ogre::ColourValue max_color = max_color_property_->getOgreColor();
-        Ogre::ColourValue min_color = min_color_property_->getOgreColor();
 
-        if (use_rainbow_property_->getBool())
+        // the label colors are scaled into [min_shading, 1] by the normalized intensity
+        const float min_shading = std::min(1.0f, std::max(0.0f, min_shading_property_->getFloat()));
+        const float shading_range = 1.0f - min_shading;
+        const bool shade_alpha = shading_mode_property_->getOptionInt() == SHADE_ALPHA;
+
+        for (uint32_t i = 0; i < num_points; ++i)
         {
-            for (uint32_t i = 0; i < num_points; ++i)
+            uint16_t val = out.labels[i];
+            float intensity = out.values[i];
+            float normalized_intensity = (intensity - min_intensity) / diff_intensity;
+            normalized_intensity = std::min(1.0f, std::max(0.0f, normalized_intensity));
+            const float shading = min_shading + shading_range * normalized_intensity;
+
+            Ogre::ColourValue& color = out.colors[i];
+            color = ColorHelper::getOgreColorFromList(val % static_cast<int>(ColorHelper::getColorListSize()));
+            if (palette)
             {
-                float val = valueFromCloud<float>(cloud, offset, type, point_step, i);
-                float value = 1.0 - (val - min_intensity) / diff_intensity;
-                if (invert_rainbow_property_->getBool())
-                {
-                    value = 1.0 - value;
-                }
-                getRainbowColorLabel(value, points_out[i].color);
-
-                if (filter_activated)
-                {
-                    const uint32_t filter_offset = cloud->fields[range_filter_index].offset;
-                    const uint8_t filter_type = cloud->fields[range_filter_index].datatype;
-                    auto filter_val = valueFromCloud<float>(cloud, filter_offset, filter_type, point_step, i);
-                    if(!test_value(filter_val,lower_desired_value,upper_desired_value,invert_filter_activated))
-                    {
-                        points_out[i].color.a = 0.f;
-                        // put those points to origin in order to not accidentally select them with the selection tool
-                        points_out[i].position.x = 0.f;
-                        points_out[i].position.y = 0.f;
-                        points_out[i].position.z = 0.f;
-                    }
-                }
+                color = palette->color(val, color);
             }
-        }
-        else
-        {
-            for (uint32_t i = 0; i < num_points; ++i)
+            if (shade_alpha)
             {
-                float val = valueFromCloud<float>(cloud, offset, type, point_step, i);
-                float normalized_intensity = (val - min_intensity) / diff_intensity;
-                normalized_intensity = std::min(1.0f, std::max(0.0f, normalized_intensity));
-                points_out[i].color.r =
-                        max_color.r * normalized_intensity + min_color.r * (1.0f - normalized_intensity);
-                points_out[i].color.g =
-                        max_color.g * normalized_intensity + min_color.g * (1.0f - normalized_intensity);
-                points_out[i].color.b =
-                        max_color.b * normalized_intensity + min_color.b * (1.0f - normalized_intensity);
-
-                if (filter_activated)
-                {
-                    const uint32_t filter_offset = cloud->fields[range_filter_index].offset;
-                    const uint8_t filter_type = cloud->fields[range_filter_index].datatype;
-                    auto filter_val = valueFromCloud<float>(cloud, filter_offset, filter_type, point_step, i);
-                    if(!test_value(filter_val,lower_desired_value,upper_desired_value,invert_filter_activated))
-                    {
-                        points_out[i].color.a = 0.f;
-                        // put those points to origin in order to not accidentally select them with the selection tool
-                        points_out[i].position.x = 0.f;
-                        points_out[i].position.y = 0.f;
-                        points_out[i].position.z = 0.f;
-                    }
-                }
+                color.a = shading;
+            }
+            else
+            {
+                color.r *= shading;
+                color.g *= shading;
+                color.b *= shading;
             }
         }
 
         return true;
     }
 
-    uint8_t RangePCTransformer::score(const sensor_msgs::PointCloud2ConstPtr& cloud)
-    {
-        return 255;
-    }
-
-    void RangePCTransformer::createProperties(Property* parent_property, uint32_t mask, QList<Property*>& out_props)
+    void LabelIntensityPCTransformer::createProperties(Property* parent_property, uint32_t mask, QList<Property*>& out_props)
     {
-
         if (mask & Support_Color)
         {
-
-            channel_name_property_ =
-                    new EditableEnumProperty("Channel Name", "intensity",
-                                             "Select the channel to use to compute the intensity", parent_property,
-                                             SIGNAL(needRetransform()), this);
-
-            use_rainbow_property_ =
-                    new BoolProperty("Use rainbow", true,
-                                     "Whether to use a rainbow of colors or interpolate between two",
-                                     parent_property, SLOT(updateUseRainbow()), this);
-            invert_rainbow_property_ =
-                    new BoolProperty("Invert Rainbow", false, "Whether to invert rainbow colors", parent_property,
-                                     SLOT(updateUseRainbow()), this);
-
-            min_color_property_ =
-                    new ColorProperty("Min Color", Qt::black,
-                                      "Color to assign the points with the minimum intensity.  "
-                                      "Actual color is interpolated between this and Max Color.",
-                                      parent_property,
-                                      SIGNAL(needRetransform()), this);
-
-            max_color_property_ =
-                    new ColorProperty("Max Color", Qt::white,
-                                      "Color to assign the points with the maximum intensity.  "
-                                      "Actual color is interpolated between this and Min Color.",
-                                      parent_property,
-                                      SIGNAL(needRetransform()), this);
+            channel_name_property_ = new EditableEnumProperty("Channel Name",
+                                                              "sem_label",
+                                                              "Select the channel to use to colorize by label",
+                                                              parent_property,
+                                                              SLOT(updateChannelNames()),
+                                                              this);
+
+            Property* palette_file_property = palette_file_.createProperty(parent_property);
+            connect(&palette_file_, &LabelPaletteFile::changed, this, &LabelIntensityPCTransformer::needRetransform);
+
+            intensity_channel_name_property_ =
+                    new EditableEnumProperty("Shading Channel", "intensity",
+                                             "Select the channel used to shade the label colors", parent_property,
+                                             SLOT(updateChannelNames()), this);
+
+            shading_mode_property_ =
+                    new EnumProperty("Shading Mode", "Brightness",
+                                     "Whether the shading channel scales the brightness or the alpha of the label "
+                                     "color. rviz only draws per point alpha if the Alpha of the display is below 1 "
+                                     "or the cloud has an rgba field, otherwise Alpha shading has no visible effect.",
+                                     parent_property, SIGNAL(needRetransform()), this);
+            shading_mode_property_->addOption("Brightness", SHADE_BRIGHTNESS);
+            shading_mode_property_->addOption("Alpha", SHADE_ALPHA);
+
+            min_shading_property_ =
+                    new FloatProperty("Min Shading", 0.2,
+                                      "Brightness or alpha of the points with the minimum intensity.",
+                                      parent_property, SIGNAL(needRetransform()), this);
+            min_shading_property_->setMin(0.0);
+            min_shading_property_->setMax(1.0);
 
             auto_compute_intensity_bounds_property_ =
                     new BoolProperty("Autocompute Intensity Bounds", true,
@@ -740,82 +1518,71 @@ void LabelPCTransformer::updateChannels(const sensor_msgs::PointCloud2ConstPtr&
 
             min_intensity_property_ = new FloatProperty(
                     "Min Intensity", 0,
-                    "Minimum possible intensity value, used to interpolate from Min Color to Max Color for a point.",
+                    "Minimum possible intensity value, mapped to Min Shading.",
                     parent_property);
 
             max_intensity_property_ = new FloatProperty(
                     "Max Intensity", 4096,
-                    "Maximum possible intensity value, used to interpolate from Min Color to Max Color for a point.",
+                    "Maximum possible intensity value, mapped to the full label color.",
                     parent_property);
 
-
-            filter_property_ = new BoolProperty(
-                    "Filter range", false, "Show only points in or out of given range", parent_property, SIGNAL(needRetransform()), this);
-            filter_property_->setDisableChildrenIfFalse(true);
-            filter_channel_name_property_ = new EditableEnumProperty("Channel Name",
+            show_only_property_ = new BoolProperty(
+                    "Show only", false, "Show only points with value", parent_property, SIGNAL(needRetransform()), this);
+            show_only_property_->setDisableChildrenIfFalse(true);
+            show_only_channel_name_property_ = new EditableEnumProperty("Channel Name",
                                                                         "sem_label",
                                                                         "Select the channel by which to hide",
-                                                                     filter_property_,
-                                                                        SIGNAL(needRetransform()),
+                                                                        show_only_property_,
+                                                                        SLOT(updateChannelNames()),
                                                                         this);
-            filter_lower_value_property_ =
-                    new FloatProperty("Lower Limit", 0, "Select the value", filter_property_, SIGNAL(needRetransform()), this);
-            filter_upper_value_property_ =
-                    new FloatProperty("Upper Limit", 0, "Select the value", filter_property_, SIGNAL(needRetransform()), this);
-
-            invert_filter_property_ = new BoolProperty(
-                    "Invert Filter", false, "Show only points outside of given range", filter_property_, SIGNAL(needRetransform()), this);
-
-            use_permanent_intensity_property_ =
-                    new BoolProperty("Persistent Intensity values", true,
-                                     "Whether to keep min/max intensity values across point clouds.",
-                                     parent_property);
+            show_only_value_property_ =
+                    new IntProperty("Equal To", 0, "Select the value", show_only_property_, SIGNAL(needRetransform()), this);
 
             out_props.push_back(channel_name_property_);
-            out_props.push_back(use_rainbow_property_);
-            out_props.push_back(invert_rainbow_property_);
-            out_props.push_back(min_color_property_);
-            out_props.push_back(max_color_property_);
+            out_props.push_back(palette_file_property);
+            out_props.push_back(intensity_channel_name_property_);
+            out_props.push_back(shading_mode_property_);
+            out_props.push_back(min_shading_property_);
             out_props.push_back(auto_compute_intensity_bounds_property_);
-            out_props.push_back(use_permanent_intensity_property_);
             out_props.push_back(min_intensity_property_);
             out_props.push_back(max_intensity_property_);
-            out_props.push_back(filter_property_);
-
+            out_props.push_back(show_only_property_);
+            createCommonProperties(parent_property, out_props);
+            addChannelProperty(channel_name_property_);
+            addChannelProperty(intensity_channel_name_property_);
+            addChannelProperty(show_only_channel_name_property_);
 
-            updateUseRainbow();
             updateAutoComputeIntensityBounds();
-
+            updateChannelNames();
         }
     }
 
-    void RangePCTransformer::updateChannels(const sensor_msgs::PointCloud2ConstPtr& cloud)
+    void LabelIntensityPCTransformer::updateChannelNames()
+    {
+        channel_name_ = channel_name_property_->getStdString();
+        intensity_channel_name_ = intensity_channel_name_property_->getStdString();
+        show_only_channel_name_ = show_only_channel_name_property_->getStdString();
+        Q_EMIT needRetransform();
+    }
+
+    void LabelIntensityPCTransformer::updateCloudProperties()
     {
-        std::vector<std::string> channels;
-        for (const auto& field : cloud->fields)
+        // values entered by the user while a cloud was colorized must not be overwritten
+        if (!auto_compute_intensity_bounds_property_->getBool())
         {
-            channels.push_back(field.name);
+            return;
         }
-        std::sort(channels.begin(), channels.end());
-
-        if (channels != available_channels_)
+        float min_intensity, max_intensity;
         {
-            channel_name_property_->clearOptions();
-            filter_channel_name_property_->clearOptions();
-            for (auto& channel : channels)
-            {
-                if (channel.empty())
-                {
-                    continue;
-                }
-                channel_name_property_->addOptionStd(channel);
-                filter_channel_name_property_->addOptionStd(channel);
-            }
-            available_channels_ = channels;
+            std::lock_guard<std::mutex> lock(cloud_properties_mutex_);
+            min_intensity = shown_min_intensity_;
+            max_intensity = shown_max_intensity_;
         }
+        min_intensity_property_->setFloat(min_intensity);
+        max_intensity_property_->setFloat(max_intensity);
     }
 
-    void RangePCTransformer::updateAutoComputeIntensityBounds()
+    void LabelIntensityPCTransformer::updateAutoComputeIntensityBounds()
     {
         bool auto_compute = auto_compute_intensity_bounds_property_->getBool();
         min_intensity_property_->setReadOnly(auto_compute);
@@ -823,32 +1590,24 @@ void LabelPCTransformer::updateChannels(const sensor_msgs::PointCloud2ConstPtr&
         if (auto_compute)
         {
             disconnect(min_intensity_property_, &Property::changed, this,
-                       &RangePCTransformer::needRetransform);
+                       &LabelIntensityPCTransformer::needRetransform);
             disconnect(max_intensity_property_, &Property::changed, this,
-                       &RangePCTransformer::needRetransform);
+                       &LabelIntensityPCTransformer::needRetransform);
         }
         else
         {
             connect(min_intensity_property_, &Property::changed, this,
-                    &RangePCTransformer::needRetransform);
+                    &LabelIntensityPCTransformer::needRetransform);
             connect(max_intensity_property_, &Property::changed, this,
-                    &RangePCTransformer::needRetransform);
+                    &LabelIntensityPCTransformer::needRetransform);
         }
         Q_EMIT needRetransform();
     }
 
-    void RangePCTransformer::updateUseRainbow()
-    {
-        bool use_rainbow = use_rainbow_property_->getBool();
-        invert_rainbow_property_->setHidden(!use_rainbow);
-        min_color_property_->setHidden(use_rainbow);
-        max_color_property_->setHidden(use_rainbow);
-        Q_EMIT needRetransform();
-    }
-
 } // namespace rviz
 
 #include <pluginlib/class_list_macros.hpp>
 PLUGINLIB_EXPORT_CLASS(rviz::LabelPCTransformer, rviz::PointCloudTransformer)
 PLUGINLIB_EXPORT_CLASS(rviz::IntensityLabelPCTransformer, rviz::PointCloudTransformer)
 PLUGINLIB_EXPORT_CLASS(rviz::RangePCTransformer, rviz::PointCloudTransformer)
+PLUGINLIB_EXPORT_CLASS(rviz::LabelIntensityPCTransformer, rviz::PointCloudTransformer)
@@ -2,16 +2,52 @@
 
 #include <rviz/default_plugin/point_cloud_transformer.h>
 
+#include <ros/ros.h>
+#include <std_msgs/UInt32MultiArray.h>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "label_palette.h"
+#include "label_palette_file.h"
+#include "normalization.h"
+#include "region_of_interest.h"
+#include "voxel_thinning.h"
+
 namespace rviz
 {
 
 class EditableEnumProperty;
+class EnumProperty;
 class IntProperty;
 class BoolProperty;
 class ColorProperty;
 class FloatProperty;
+class StringProperty;
 
-class LabelPCTransformer : public PointCloudTransformer
+// Colors and filter result of one cloud, with the decoding buffers reused across clouds
+struct ColorizedCloud
+{
+    std::vector<Ogre::ColourValue> colors;
+    // non zero for points hidden by the filters
+    std::vector<uint8_t> hidden;
+
+    // decoding scratch buffers
+    std::vector<float> values;
+    std::vector<double> times;
+    std::vector<float> filter_values;
+    std::vector<uint16_t> labels;
+    std::vector<uint16_t> filter_labels;
+    std::vector<float> normalized;
+    normalization::Normalizer normalizer;
+};
+
+// Base of the transformers which colorize the points by their channels. transform() decodes the positions of clouds
+// in the other byte order, marks the points outside the region of interest, lets colorize() compute the colors and
+// hides the filtered points before thinning the cloud to voxels.
+class ColorPCTransformer : public PointCloudTransformer
 {
     Q_OBJECT
   public:
@@ -21,37 +57,131 @@ class LabelPCTransformer : public PointCloudTransformer
                    const Ogre::Matrix4& transform,
                    V_PointCloudPoint& points_out) override;
     uint8_t score(const sensor_msgs::PointCloud2ConstPtr& cloud) override;
-    void createProperties(Property* parent_property, uint32_t mask, QList<Property*>& out_props) override;
-    void updateChannels(const sensor_msgs::PointCloud2ConstPtr& cloud);
+
+  protected:
+    // with_alpha is set by transformers whose colors include the alpha, the others keep the alpha of the points
+    explicit ColorPCTransformer(bool with_alpha);
+
+    // computes the colors and the hidden points of the cloud, outside optionally masks points of the region of
+    // interest. Returns false if a selected channel is missing.
+    virtual bool colorize(const sensor_msgs::PointCloud2ConstPtr& cloud,
+                          const std::vector<uint8_t>* outside,
+                          ColorizedCloud& out) = 0;
+
+    // the channels of each new cloud are offered as the options of the property
+    void addChannelProperty(EditableEnumProperty* property);
+    // creates the region of interest and voxel thinning properties, called at the end of createProperties()
+    void createCommonProperties(Property* parent_property, QList<Property*>& out_props);
+
+    // transform() runs on the display's message thread, where properties must not be written. colorize() stores the
+    // values to show under the mutex and posts updateCloudProperties() to the main thread, like Display::setStatus().
+    // A post still pending is not repeated, so the properties show the latest cloud.
+    void postCloudProperties();
+    virtual void updateCloudProperties() = 0;
+    std::mutex cloud_properties_mutex_;
+
+  private Q_SLOTS:
+    void applyCloudProperties();
 
   private:
+    void updateChannels(const sensor_msgs::PointCloud2ConstPtr& cloud);
+
+    std::atomic<bool> cloud_properties_pending_{false};
+    bool with_alpha_;
+    ColorizedCloud colorized_;
+
     std::vector<std::string> available_channels_;
+    std::vector<EditableEnumProperty*> channel_properties_;
+
+    // coordinates of clouds in the other byte order, decoded again for the positions
+    std::vector<float> swapped_positions_;
+
+    RegionOfInterest roi_;
+
+    VoxelThinning voxel_thinning_;
+    BoolProperty* voxel_thinning_property_;
+    FloatProperty* voxel_size_property_;
+};
+
+
+class LabelPCTransformer : public ColorPCTransformer
+{
+    Q_OBJECT
+  public:
+    LabelPCTransformer();
+    void createProperties(Property* parent_property, uint32_t mask, QList<Property*>& out_props) override;
+
+  private Q_SLOTS:
+    void updateChannelNames();
+    void updateStatisticsTopic();
+    void updateStatisticsRows();
+    void updatePaletteOptions();
+
+  private:
+    bool colorize(const sensor_msgs::PointCloud2ConstPtr& cloud,
+                  const std::vector<uint8_t>* outside,
+                  ColorizedCloud& out) override;
+    void updateLabelStatistics(const LabelPalette::ConstPtr& palette);
+    void updateCloudProperties() override;
+
+    LabelPaletteFile palette_file_;
+
+    std::string channel_name_;
+    std::string show_only_channel_name_;
+    uint16_t show_only_value_{0};
     EditableEnumProperty* channel_name_property_;
     BoolProperty* show_only_property_;
-    IntProperty* show_only_value_property_;
+    EditableEnumProperty* show_only_value_property_;
     EditableEnumProperty* show_only_channel_name_property_;
+
+    // points per label (indexed by label) in the current cloud
+    std::vector<uint32_t> label_counts_;
+    std::vector<std::pair<uint16_t, uint32_t>> top_labels_;
+    // top labels of the last cloud and the palette it was colorized with, guarded by cloud_properties_mutex_
+    std::vector<std::pair<uint16_t, uint32_t>> shown_top_labels_;
+    LabelPalette::ConstPtr shown_palette_;
+    // rows of the counts, created on the main thread when Top N changes
+    std::vector<Property*> label_count_properties_;
+    // label shown by each count property and the palette its name was taken from
+    std::vector<int32_t> label_count_ids_;
+    LabelPalette::ConstPtr label_count_palette_;
+    std_msgs::UInt32MultiArray statistics_msg_;
+    BoolProperty* statistics_property_;
+    IntProperty* statistics_top_n_property_;
+    Property* statistics_counts_property_;
+    BoolProperty* statistics_publish_property_;
+    StringProperty* statistics_topic_property_;
+    ros::NodeHandle nh_;
+    ros::Publisher statistics_pub_;
 };
 
 
-class IntensityLabelPCTransformer : public PointCloudTransformer
+class IntensityLabelPCTransformer : public ColorPCTransformer
 {
     Q_OBJECT
     public:
-        uint8_t supports(const sensor_msgs::PointCloud2ConstPtr& cloud) override;
-        bool transform(const sensor_msgs::PointCloud2ConstPtr& cloud,
-                       uint32_t mask,
-                       const Ogre::Matrix4& transform,
-                       V_PointCloudPoint& points_out) override;
-        uint8_t score(const sensor_msgs::PointCloud2ConstPtr& cloud) override;
+        IntensityLabelPCTransformer();
         void createProperties(Property* parent_property, uint32_t mask, QList<Property*>& out_props) override;
-        void updateChannels(const sensor_msgs::PointCloud2ConstPtr& cloud);
 
     private Q_SLOTS:
-        void updateUseRainbow();
+        void updateChannelNames();
+        void updateColorMap();
+        void migrateLegacyColorMap();
+        void updateNormalization();
         void updateAutoComputeIntensityBounds();
 
     private:
-        std::vector<std::string> available_channels_;
+        bool colorize(const sensor_msgs::PointCloud2ConstPtr& cloud,
+                      const std::vector<uint8_t>* outside,
+                      ColorizedCloud& out) override;
+        void updateCloudProperties() override;
+
+        // autocomputed bounds of the last cloud, guarded by cloud_properties_mutex_
+        float shown_min_intensity_{0.f};
+        float shown_max_intensity_{0.f};
+
+        std::string channel_name_;
+        std::string show_only_channel_name_;
         EditableEnumProperty* channel_name_property_;
         BoolProperty* show_only_property_;
         FloatProperty* show_only_value_property_;
@@ -60,29 +190,32 @@ class IntensityLabelPCTransformer : public PointCloudTransformer
         ColorProperty* min_color_property_;
         ColorProperty* max_color_property_;
         BoolProperty* auto_compute_intensity_bounds_property_;
-        BoolProperty* use_rainbow_property_;
-        BoolProperty* invert_rainbow_property_;
+        BoolProperty* time_property_;
+        EnumProperty* time_origin_property_;
+        EnumProperty* normalization_property_;
+        FloatProperty* gamma_property_;
+        FloatProperty* log_scale_property_;
+        EnumProperty* color_map_property_;
+        BoolProperty* invert_color_map_property_;
+        BoolProperty* legacy_use_rainbow_property_;
+        BoolProperty* legacy_invert_rainbow_property_;
         FloatProperty* min_intensity_property_;
         FloatProperty* max_intensity_property_;
-
 };
 
 
-    class RangePCTransformer : public PointCloudTransformer
+    class RangePCTransformer : public ColorPCTransformer
     {
     Q_OBJECT
     public:
-        uint8_t supports(const sensor_msgs::PointCloud2ConstPtr& cloud) override;
-        bool transform(const sensor_msgs::PointCloud2ConstPtr& cloud,
-                       uint32_t mask,
-                       const Ogre::Matrix4& transform,
-                       V_PointCloudPoint& points_out) override;
-        uint8_t score(const sensor_msgs::PointCloud2ConstPtr& cloud) override;
+        RangePCTransformer();
         void createProperties(Property* parent_property, uint32_t mask, QList<Property*>& out_props) override;
-        void updateChannels(const sensor_msgs::PointCloud2ConstPtr& cloud);
 
     private Q_SLOTS:
-        void updateUseRainbow();
+        void updateChannelNames();
+        void updateColorMap();
+        void migrateLegacyColorMap();
+        void updateNormalization();
         void updateAutoComputeIntensityBounds();
 
     private:
@@ -92,16 +225,50 @@ class IntensityLabelPCTransformer : public PointCloudTransformer
             return invert?(val>=up||val<=low):(low<=val&&val<=up);
         };
 
-        int32_t selected_chanel{-1};
+        // running statistics of a channel across point clouds
+        struct ChannelStatistics
+        {
+            float min{999999.0f};
+            float max{-999999.0f};
+            uint64_t count{0};
+            double mean{0.0};
+            // sum of squared deviations from the mean
+            double m2{0.0};
+
+            // merges the bounds and the moments of one cloud, given as sums of the offsets to shift
+            void merge(float cloud_min, float cloud_max, uint64_t cloud_count, double shift, double sum, double sum_sq);
+
+            double variance() const
+            {
+                return count > 1 ? m2 / (count - 1) : 0.0;
+            }
+        };
+
+        // the persistent statistics of the colorized channel, nullptr if the cloud does not have it
+        ChannelStatistics* findStatistics(const sensor_msgs::PointCloud2ConstPtr& cloud);
+        bool colorize(const sensor_msgs::PointCloud2ConstPtr& cloud,
+                      const std::vector<uint8_t>* outside,
+                      ColorizedCloud& out) override;
+        void updateCloudProperties() override;
+
+        // autocomputed bounds and persistent moments of the last cloud, guarded by cloud_properties_mutex_
+        float shown_min_intensity_{0.f};
+        float shown_max_intensity_{0.f};
+        float shown_mean_{0.f};
+        float shown_std_dev_{0.f};
+
         bool continuous_int_switched{true};
-        float continuous_min_intensity{999999.0f};
-        float continuous_max_intensity{-999999.0f};
+        std::map<std::string, ChannelStatistics> channel_statistics_;
+        std::string statistics_key_;
 
-        std::vector<std::string> available_channels_;
+        std::string channel_name_;
+        std::string filter_channel_name_;
         EditableEnumProperty* channel_name_property_;
         BoolProperty* filter_property_;
         BoolProperty* invert_filter_property_;
         BoolProperty* use_permanent_intensity_property_;
+        FloatProperty* mean_property_;
+        FloatProperty* std_dev_property_;
         FloatProperty* filter_lower_value_property_;
         FloatProperty* filter_upper_value_property_;
         EditableEnumProperty* filter_channel_name_property_;
@@ -109,11 +276,63 @@ class IntensityLabelPCTransformer : public PointCloudTransformer
         ColorProperty* min_color_property_;
         ColorProperty* max_color_property_;
         BoolProperty* auto_compute_intensity_bounds_property_;
-        BoolProperty* use_rainbow_property_;
-        BoolProperty* invert_rainbow_property_;
+        BoolProperty* time_property_;
+        EnumProperty* time_origin_property_;
+        EnumProperty* normalization_property_;
+        FloatProperty* gamma_property_;
+        FloatProperty* log_scale_property_;
+        EnumProperty* color_map_property_;
+        BoolProperty* invert_color_map_property_;
+        BoolProperty* legacy_use_rainbow_property_;
+        BoolProperty* legacy_invert_rainbow_property_;
         FloatProperty* min_intensity_property_;
         FloatProperty* max_intensity_property_;
+    };
+
+
+    class LabelIntensityPCTransformer : public ColorPCTransformer
+    {
+    Q_OBJECT
+    public:
+        LabelIntensityPCTransformer();
+        void createProperties(Property* parent_property, uint32_t mask, QList<Property*>& out_props) override;
 
+    private Q_SLOTS:
+        void updateChannelNames();
+        void updateAutoComputeIntensityBounds();
+
+    private:
+        enum ShadingMode
+        {
+            SHADE_BRIGHTNESS,
+            SHADE_ALPHA
+        };
+
+        bool colorize(const sensor_msgs::PointCloud2ConstPtr& cloud,
+                      const std::vector<uint8_t>* outside,
+                      ColorizedCloud& out) override;
+        void updateCloudProperties() override;
+
+        // autocomputed bounds of the last cloud, guarded by cloud_properties_mutex_
+        float shown_min_intensity_{0.f};
+        float shown_max_intensity_{0.f};
+
+        LabelPaletteFile palette_file_;
+
+        std::string channel_name_;
+        std::string intensity_channel_name_;
+        std::string show_only_channel_name_;
+        EditableEnumProperty* channel_name_property_;
+        BoolProperty* show_only_property_;
+        IntProperty* show_only_value_property_;
+        EditableEnumProperty* show_only_channel_name_property_;
+
+        EditableEnumProperty* intensity_channel_name_property_;
+        EnumProperty* shading_mode_property_;
+        FloatProperty* min_shading_property_;
+        BoolProperty* auto_compute_intensity_bounds_property_;
+        FloatProperty* min_intensity_property_;
+        FloatProperty* max_intensity_property_;
     };
 
 }; // namespace rviz
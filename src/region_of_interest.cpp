@@ -0,0 +1,155 @@
+#include "region_of_interest.h"
+
+#include <rviz/properties/bool_property.h>
+#include <rviz/properties/enum_property.h>
+#include <rviz/properties/float_property.h>
+#include <rviz/properties/vector_property.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace rviz
+{
+
+Property* RegionOfInterest::createProperties(Property* parent)
+{
+    enabled_property_ = new BoolProperty("Region of Interest",
+                                         false,
+                                         "Show only points inside a region, the bounds are computed from these points",
+                                         parent,
+                                         SIGNAL(needRetransform()),
+                                         this);
+    enabled_property_->setDisableChildrenIfFalse(true);
+
+    shape_property_ = new EnumProperty(
+        "Shape", "Axis Aligned Box", "Shape of the region", enabled_property_, SLOT(updateShape()), this);
+    shape_property_->addOption("Axis Aligned Box", AXIS_ALIGNED_BOX);
+    shape_property_->addOption("Oriented Box", ORIENTED_BOX);
+    shape_property_->addOption("Cylinder", CYLINDER);
+
+    frame_property_ = new EnumProperty("Frame",
+                                       "Fixed Frame",
+                                       "Frame the region is defined in, the fixed frame or the frame of the cloud",
+                                       enabled_property_,
+                                       SIGNAL(needRetransform()),
+                                       this);
+    frame_property_->addOption("Fixed Frame", FIXED_FRAME);
+    frame_property_->addOption("Sensor Frame", SENSOR_FRAME);
+
+    center_property_ = new VectorProperty("Center",
+                                          Ogre::Vector3(0.f, 0.f, 0.f),
+                                          "Center of the region in meters",
+                                          enabled_property_,
+                                          SIGNAL(needRetransform()),
+                                          this);
+    size_property_ = new VectorProperty("Size",
+                                        Ogre::Vector3(20.f, 20.f, 10.f),
+                                        "Edge lengths of the box in meters",
+                                        enabled_property_,
+                                        SIGNAL(needRetransform()),
+                                        this);
+    yaw_property_ = new FloatProperty(
+        "Yaw", 0, "Rotation of the box around the z axis in degrees", enabled_property_, SIGNAL(needRetransform()), this);
+    radius_property_ = new FloatProperty(
+        "Radius", 10, "Radius of the cylinder in meters", enabled_property_, SIGNAL(needRetransform()), this);
+    radius_property_->setMin(0);
+    height_property_ = new FloatProperty("Height",
+                                         10,
+                                         "Height of the cylinder along the z axis in meters",
+                                         enabled_property_,
+                                         SIGNAL(needRetransform()),
+                                         this);
+    height_property_->setMin(0);
+
+    updateShape();
+    return enabled_property_;
+}
+
+bool RegionOfInterest::enabled() const
+{
+    return enabled_property_ && enabled_property_->getBool();
+}
+
+void RegionOfInterest::updateShape()
+{
+    const int shape = shape_property_->getOptionInt();
+    size_property_->setHidden(shape == CYLINDER);
+    yaw_property_->setHidden(shape != ORIENTED_BOX);
+    radius_property_->setHidden(shape != CYLINDER);
+    height_property_->setHidden(shape != CYLINDER);
+    Q_EMIT needRetransform();
+}
+
+bool RegionOfInterest::update(const Ogre::Matrix4& transform, const V_PointCloudPoint& points)
+{
+    if (!enabled())
+    {
+        return false;
+    }
+
+    const int shape = shape_property_->getOptionInt();
+    const bool fixed_frame = frame_property_->getOptionInt() == FIXED_FRAME;
+    const Ogre::Vector3 center = center_property_->getVector();
+    const float yaw = shape == ORIENTED_BOX ? yaw_property_->getFloat() * static_cast<float>(M_PI / 180.0) : 0.f;
+    const float cos_yaw = std::cos(yaw);
+    const float sin_yaw = std::sin(yaw);
+
+    // affine map from the sensor frame into the frame of the region: into the fixed frame if the region is defined
+    // there, then moved by the center and rotated by -yaw
+    float frame[3][4];
+    for (int row = 0; row < 3; ++row)
+    {
+        for (int col = 0; col < 4; ++col)
+        {
+            frame[row][col] = fixed_frame ? static_cast<float>(transform[row][col]) : (row == col ? 1.f : 0.f);
+        }
+    }
+    frame[0][3] -= center.x;
+    frame[1][3] -= center.y;
+    frame[2][3] -= center.z;
+    float m[3][4];
+    for (int col = 0; col < 4; ++col)
+    {
+        m[0][col] = cos_yaw * frame[0][col] + sin_yaw * frame[1][col];
+        m[1][col] = -sin_yaw * frame[0][col] + cos_yaw * frame[1][col];
+        m[2][col] = frame[2][col];
+    }
+
+    // branch free tests without early exits, so the loops vectorize. NaN positions fail every comparison and end
+    // up outside.
+    const size_t num_points = points.size();
+    outside_.resize(num_points);
+    uint8_t* outside = outside_.data();
+    if (shape == CYLINDER)
+    {
+        const float radius = radius_property_->getFloat();
+        const float radius_sq = radius * radius;
+        const float half_height = 0.5f * height_property_->getFloat();
+        for (size_t i = 0; i < num_points; ++i)
+        {
+            const Ogre::Vector3& p = points[i].position;
+            const float x = m[0][0] * p.x + m[0][1] * p.y + m[0][2] * p.z + m[0][3];
+            const float y = m[1][0] * p.x + m[1][1] * p.y + m[1][2] * p.z + m[1][3];
+            const float z = m[2][0] * p.x + m[2][1] * p.y + m[2][2] * p.z + m[2][3];
+            outside[i] = !((x * x + y * y <= radius_sq) & (std::abs(z) <= half_height));
+        }
+    }
+    else
+    {
+        const Ogre::Vector3 size = size_property_->getVector();
+        const float half_x = 0.5f * size.x;
+        const float half_y = 0.5f * size.y;
+        const float half_z = 0.5f * size.z;
+        for (size_t i = 0; i < num_points; ++i)
+        {
+            const Ogre::Vector3& p = points[i].position;
+            const float x = m[0][0] * p.x + m[0][1] * p.y + m[0][2] * p.z + m[0][3];
+            const float y = m[1][0] * p.x + m[1][1] * p.y + m[1][2] * p.z + m[1][3];
+            const float z = m[2][0] * p.x + m[2][1] * p.y + m[2][2] * p.z + m[2][3];
+            outside[i] = !((std::abs(x) <= half_x) & (std::abs(y) <= half_y) & (std::abs(z) <= half_z));
+        }
+    }
+    return true;
+}
+
+} // namespace rviz
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <rviz/default_plugin/point_cloud_transformer.h>
+
+#include <QObject>
+
+#include <cstdint>
+#include <vector>
+
+namespace rviz
+{
+
+class BoolProperty;
+class EnumProperty;
+class FloatProperty;
+class Property;
+class VectorProperty;
+
+// Crops the cloud to an axis aligned box, an oriented box or a vertical cylinder, given in the fixed or the sensor
+// frame. Points outside are marked in a mask which is kept across messages, so the transformers can exclude them
+// from the bounds before hiding them like filtered points.
+class RegionOfInterest : public QObject
+{
+    Q_OBJECT
+  public:
+    enum Shape
+    {
+        AXIS_ALIGNED_BOX,
+        ORIENTED_BOX,
+        CYLINDER
+    };
+
+    enum Frame
+    {
+        FIXED_FRAME,
+        SENSOR_FRAME
+    };
+
+    // creates the properties below parent and returns the top level one
+    Property* createProperties(Property* parent);
+
+    bool enabled() const;
+
+    // marks the points outside the region, returns false if the region is disabled. The positions are in the sensor
+    // frame and transform maps them into the fixed frame. Must be called before other filters move points.
+    bool update(const Ogre::Matrix4& transform, const V_PointCloudPoint& points);
+
+    // non zero for points outside the region, valid after update() returned true
+    const std::vector<uint8_t>& outside() const
+    {
+        return outside_;
+    }
+
+  Q_SIGNALS:
+    void needRetransform();
+
+  private Q_SLOTS:
+    void updateShape();
+
+  private:
+    std::vector<uint8_t> outside_;
+
+    BoolProperty* enabled_property_{nullptr};
+    EnumProperty* shape_property_;
+    EnumProperty* frame_property_;
+    VectorProperty* center_property_;
+    VectorProperty* size_property_;
+    FloatProperty* yaw_property_;
+    FloatProperty* radius_property_;
+    FloatProperty* height_property_;
+};
+
+} // namespace rviz
@@ -0,0 +1,90 @@
+#include "voxel_thinning.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace rviz
+{
+
+namespace
+{
+    const float MAX_VOXEL_COORDINATE = 1073741824.f;
+}
+
+void VoxelThinning::apply(float voxel_size, V_PointCloudPoint& points)
+{
+    if (!(voxel_size > 0.f) || points.empty())
+    {
+        return;
+    }
+
+    // keep the load factor below 0.5, slots of previous clouds are invalidated by the epoch instead of cleared
+    size_t num_slots = 1024;
+    while (num_slots < 2 * points.size())
+    {
+        num_slots *= 2;
+    }
+    ++epoch_;
+    if (num_slots > slots_.size() || epoch_ == 0)
+    {
+        slots_.assign(std::max(num_slots, slots_.size()), Slot{0, 0, 0, 0});
+        slot_mask_ = slots_.size() - 1;
+        epoch_ = 1;
+    }
+
+    const float inv_voxel_size = 1.f / voxel_size;
+    for (auto& point : points)
+    {
+        if (point.color.a == 0.f)
+        {
+            // already hidden by another filter
+            continue;
+        }
+        const float x = std::floor(point.position.x * inv_voxel_size);
+        const float y = std::floor(point.position.y * inv_voxel_size);
+        const float z = std::floor(point.position.z * inv_voxel_size);
+        // voxel coordinates beyond +-2^30 (and NaN) do not fit the slots, those points are left visible instead of
+        // converting them to integers
+        if (!(std::abs(x) <= MAX_VOXEL_COORDINATE && std::abs(y) <= MAX_VOXEL_COORDINATE &&
+              std::abs(z) <= MAX_VOXEL_COORDINATE))
+        {
+            continue;
+        }
+
+        if (!insert(static_cast<int32_t>(x), static_cast<int32_t>(y), static_cast<int32_t>(z)))
+        {
+            point.color.a = 0.f;
+            // put those points to origin in order to not accidentally select them with the selection tool
+            point.position.x = 0.f;
+            point.position.y = 0.f;
+            point.position.z = 0.f;
+        }
+    }
+}
+
+bool VoxelThinning::insert(int32_t x, int32_t y, int32_t z)
+{
+    const uint64_t hash = static_cast<uint64_t>(static_cast<uint32_t>(x)) * 0x9E3779B97F4A7C15ull ^
+                          static_cast<uint64_t>(static_cast<uint32_t>(y)) * 0xC2B2AE3D27D4EB4Full ^
+                          static_cast<uint64_t>(static_cast<uint32_t>(z)) * 0x165667B19E3779F9ull;
+    uint64_t index = hash >> 20;
+    while (true)
+    {
+        Slot& slot = slots_[index & slot_mask_];
+        if (slot.epoch != epoch_)
+        {
+            slot.x = x;
+            slot.y = y;
+            slot.z = z;
+            slot.epoch = epoch_;
+            return true;
+        }
+        if (slot.x == x && slot.y == y && slot.z == z)
+        {
+            return false;
+        }
+        ++index;
+    }
+}
+
+} // namespace rviz
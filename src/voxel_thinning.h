@@ -0,0 +1,36 @@
+#pragma once
+
+#include <rviz/default_plugin/point_cloud_transformer.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace rviz
+{
+
+// Keeps one representative point per occupied voxel and hides the others like filtered points.
+// The open addressing hash table of the occupied voxels is kept across messages and only grows.
+class VoxelThinning
+{
+  public:
+    void apply(float voxel_size, V_PointCloudPoint& points);
+
+  private:
+    // full voxel coordinates, so distant voxels never share a slot
+    struct Slot
+    {
+        int32_t x;
+        int32_t y;
+        int32_t z;
+        uint32_t epoch;
+    };
+
+    // returns true if the voxel was not occupied in the current cloud yet
+    bool insert(int32_t x, int32_t y, int32_t z);
+
+    std::vector<Slot> slots_;
+    uint64_t slot_mask_{0};
+    uint32_t epoch_{0};
+};
+
+} // namespace rviz
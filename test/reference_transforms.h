@@ -0,0 +1,624 @@
+#pragma once
+
+#include <sensor_msgs/PointCloud2.h>
+#include <rviz/default_plugin/point_cloud_transformers.h>
+
+#include <ogre_helpers/color_material_helper.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "byte_swap.h"
+#include "color_maps.h"
+#include "field_reader.h"
+#include "normalization.h"
+
+namespace rviz
+{
+namespace test
+{
+// Plain per point versions of the kernels and the transformers, written for clarity instead of speed. The
+// transforms are the ones of the original plugin, which only handled clouds in host byte order and linear bounds,
+// with the later additions (normalization curves, color maps, time channels, regions and shading) written the same
+// plain way.
+namespace reference
+{
+    template <typename Stored, typename T>
+    inline T readAs(const uint8_t* data, const bool swap)
+    {
+        uint8_t bytes[sizeof(Stored)];
+        for (size_t b = 0; b < sizeof(Stored); ++b)
+        {
+            bytes[b] = data[swap ? sizeof(Stored) - 1 - b : b];
+        }
+        Stored value;
+        std::memcpy(&value, bytes, sizeof(Stored));
+        return static_cast<T>(value);
+    }
+
+    // value of one point like valueFromCloud, signed integers are read as unsigned and the bytes of clouds in the
+    // other byte order are reversed one by one
+    template <typename T>
+    inline T readValue(const sensor_msgs::PointCloud2& cloud, const sensor_msgs::PointField& field, const uint32_t index)
+    {
+        const uint8_t* data = cloud.data.data() + index * cloud.point_step + field.offset;
+        const bool swap = cloud.is_bigendian != byte_swap::HOST_IS_BIG_ENDIAN;
+        switch (field.datatype)
+        {
+            case sensor_msgs::PointField::INT8:
+            case sensor_msgs::PointField::UINT8:
+                return readAs<uint8_t, T>(data, swap);
+            case sensor_msgs::PointField::INT16:
+            case sensor_msgs::PointField::UINT16:
+                return readAs<uint16_t, T>(data, swap);
+            case sensor_msgs::PointField::INT32:
+            case sensor_msgs::PointField::UINT32:
+                return readAs<uint32_t, T>(data, swap);
+            case sensor_msgs::PointField::FLOAT32:
+                return readAs<float, T>(data, swap);
+            case sensor_msgs::PointField::FLOAT64:
+                return readAs<double, T>(data, swap);
+            default:
+                return T(0);
+        }
+    }
+
+    // what the coloring makes of a normalized value, NaN ends up at the lower end like in color_maps::getIndex
+    inline float clampNormalized(float value)
+    {
+        return value >= 0.0f ? (value <= 1.0f ? value : 1.0f) : 0.0f;
+    }
+
+    // the curves with the standard library functions, the linear result is not clamped
+    inline float normalize(
+        normalization::Mode mode, float gamma, float log_scale, float min_value, float diff_value, float value)
+    {
+        const float linear = (value - min_value) / diff_value;
+        const float clamped = clampNormalized(linear);
+        switch (mode)
+        {
+            case normalization::LOG:
+                return static_cast<float>(std::log1p(log_scale * clamped) / std::log1p(log_scale));
+            case normalization::SQRT:
+                return std::sqrt(clamped);
+            case normalization::GAMMA:
+                return std::pow(clamped, gamma);
+            default:
+                return linear;
+        }
+    }
+
+    // distinct voxels of the visible points, computed with an ordered set instead of the hash table. Points beyond
+    // +-2^30 voxels stay visible, each of them is counted as its own voxel. If count_points is set, the visible points
+    // with a voxel are counted instead.
+    inline size_t countOccupiedVoxels(float voxel_size, const V_PointCloudPoint& points, bool count_points = false)
+    {
+        std::set<std::tuple<int64_t, int64_t, int64_t>> voxels;
+        size_t num_points = 0;
+        size_t out_of_range = 0;
+        const float inv_voxel_size = 1.f / voxel_size;
+        for (const auto& point : points)
+        {
+            const float x = std::floor(point.position.x * inv_voxel_size);
+            const float y = std::floor(point.position.y * inv_voxel_size);
+            const float z = std::floor(point.position.z * inv_voxel_size);
+            if (point.color.a == 0.f || !std::isfinite(x + y + z))
+            {
+                continue;
+            }
+            ++num_points;
+            if (std::max({std::abs(x), std::abs(y), std::abs(z)}) > 1073741824.f)
+            {
+                ++out_of_range;
+                continue;
+            }
+            voxels.emplace(static_cast<int64_t>(x), static_cast<int64_t>(y), static_cast<int64_t>(z));
+        }
+        return count_points ? num_points : voxels.size() + out_of_range;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------
+    // transforms of the original plugin
+
+    inline void getRainbowColorLabel(float value, Ogre::ColourValue& color)
+    {
+        // this is HSV color palette with hue values going only from 0.0 to 0.833333.
+
+        value = std::min(value, 1.0f);
+        value = std::max(value, 0.0f);
+
+        float h = value * 5.0f + 1.0f;
+        int i = floor(h);
+        float f = h - i;
+        if (!(i & 1))
+            f = 1 - f; // if i is even
+        float n = 1 - f;
+
+        if (i <= 1)
+            color[0] = n, color[1] = 0, color[2] = 1;
+        else if (i == 2)
+            color[0] = 0, color[1] = n, color[2] = 1;
+        else if (i == 3)
+            color[0] = 0, color[1] = 1, color[2] = n;
+        else if (i == 4)
+            color[0] = n, color[1] = 1, color[2] = 0;
+        else if (i >= 5)
+            color[0] = 1, color[1] = n, color[2] = 0;
+    }
+
+    inline bool test_value(const float val, const float low, const float up, const bool invert)
+    {
+        return invert ? (val >= up || val <= low) : (low <= val && val <= up);
+    }
+
+    // colors and hidden points of one cloud. The original colors of NaN values are undefined (the rainbow converts
+    // NaN to int), they are marked as not defined instead.
+    struct Transformed
+    {
+        std::vector<Ogre::ColourValue> colors;
+        std::vector<uint8_t> hidden;
+        std::vector<uint8_t> color_defined;
+    };
+
+    // the bounds and colors of the intensity and range transformers
+    struct ColorSettings
+    {
+        std::string channel_name;
+        // the channel holds time stamps, which are colorized by their offset to the origin
+        bool time{false};
+        TimeOrigin time_origin{TIME_ORIGIN_HEADER};
+        normalization::Mode normalization{normalization::LINEAR};
+        float gamma{0.5f};
+        float log_scale{100.f};
+        color_maps::ColorMap color_map{color_maps::RAINBOW};
+        bool invert_color_map{false};
+        Ogre::ColourValue min_color{0.f, 0.f, 0.f, 1.f};
+        Ogre::ColourValue max_color{1.f, 1.f, 1.f, 1.f};
+        bool auto_compute_bounds{true};
+        float min_intensity{0.f};
+        float max_intensity{4096.f};
+    };
+
+    // the values of the colorized channel, time stamps are subtracted from the origin in double precision
+    inline std::vector<float> channelValues(const sensor_msgs::PointCloud2ConstPtr& cloud, const ColorSettings& settings)
+    {
+        const int32_t index = findChannelIndex(cloud, settings.channel_name);
+        const uint32_t offset = cloud->fields[index].offset;
+        const uint8_t type = cloud->fields[index].datatype;
+        const uint32_t point_step = cloud->point_step;
+        const uint32_t num_points = cloud->width * cloud->height;
+
+        std::vector<float> values(num_points);
+        if (!settings.time)
+        {
+            for (uint32_t i = 0; i < num_points; ++i)
+            {
+                values[i] = valueFromCloud<float>(cloud, offset, type, point_step, i);
+            }
+            return values;
+        }
+        std::vector<double> times(num_points);
+        double origin = 0.0;
+        if (settings.time_origin == TIME_ORIGIN_MINIMUM)
+        {
+            origin = std::numeric_limits<double>::infinity();
+        }
+        for (uint32_t i = 0; i < num_points; ++i)
+        {
+            times[i] = valueFromCloud<double>(cloud, offset, type, point_step, i);
+            if (settings.time_origin == TIME_ORIGIN_MINIMUM && times[i] < origin)
+            {
+                origin = times[i];
+            }
+        }
+        if (settings.time_origin == TIME_ORIGIN_HEADER)
+        {
+            origin = cloud->header.stamp.toSec();
+        }
+        else if (!std::isfinite(origin))
+        {
+            origin = 0.0;
+        }
+        for (uint32_t i = 0; i < num_points; ++i)
+        {
+            values[i] = static_cast<float>(times[i] - origin);
+        }
+        return values;
+    }
+
+    // the continuous color maps the tables are sampled from
+    inline color_maps::RGB colorMapAt(const color_maps::ColorMap color_map, const float t)
+    {
+        switch (color_map)
+        {
+            case color_maps::TURBO:
+                return color_maps::Turbo::at(t);
+            case color_maps::VIRIDIS:
+                return color_maps::Viridis::at(t);
+            case color_maps::INFERNO:
+                return color_maps::Inferno::at(t);
+            case color_maps::CYCLIC:
+                return color_maps::Cyclic::at(t);
+            default:
+                return color_maps::Rainbow::at(t);
+        }
+    }
+
+    // The points start white and opaque like after rviz's XYZ transformer, the color maps only set r, g and b. The
+    // rainbow and Min/Max Color are the ones of the original with the normalization curve applied. NaN values have
+    // no defined color in the other maps either, the curves put them at different ends.
+    inline void colorize(const std::vector<float>& values,
+                         const ColorSettings& settings,
+                         const float min_intensity,
+                         const float max_intensity,
+                         Transformed& out)
+    {
+        const uint32_t num_points = values.size();
+
+        float diff_intensity = max_intensity - min_intensity;
+        if (diff_intensity == 0)
+        {
+            diff_intensity = 1e20;
+        }
+        const Ogre::ColourValue& max_color = settings.max_color;
+        const Ogre::ColourValue& min_color = settings.min_color;
+
+        out.colors.assign(num_points, Ogre::ColourValue(1.f, 1.f, 1.f, 1.f));
+        out.color_defined.assign(num_points, 1);
+        for (uint32_t i = 0; i < num_points; ++i)
+        {
+            const float val = values[i];
+            const float normalized = normalize(
+                settings.normalization, settings.gamma, settings.log_scale, min_intensity, diff_intensity, val);
+            if (settings.color_map == color_maps::RAINBOW)
+            {
+                float value = 1.0 - normalized;
+                if (settings.invert_color_map)
+                {
+                    value = 1.0 - value;
+                }
+                if (std::isnan(value) || std::isnan(val))
+                {
+                    out.color_defined[i] = 0;
+                    continue;
+                }
+                getRainbowColorLabel(value, out.colors[i]);
+            }
+            else if (settings.color_map != color_maps::MIN_MAX_COLOR)
+            {
+                float value = clampNormalized(normalized);
+                if (settings.invert_color_map)
+                {
+                    value = 1.0f - value;
+                }
+                if (std::isnan(val))
+                {
+                    out.color_defined[i] = 0;
+                    continue;
+                }
+                const color_maps::RGB rgb = colorMapAt(settings.color_map, value);
+                out.colors[i].r = rgb.r;
+                out.colors[i].g = rgb.g;
+                out.colors[i].b = rgb.b;
+            }
+            else
+            {
+                float normalized_intensity = normalized;
+                normalized_intensity = std::min(1.0f, std::max(0.0f, normalized_intensity));
+                out.colors[i].r = max_color.r * normalized_intensity + min_color.r * (1.0f - normalized_intensity);
+                out.colors[i].g = max_color.g * normalized_intensity + min_color.g * (1.0f - normalized_intensity);
+                out.colors[i].b = max_color.b * normalized_intensity + min_color.b * (1.0f - normalized_intensity);
+            }
+        }
+    }
+
+    inline void transformLabel(const sensor_msgs::PointCloud2ConstPtr& cloud,
+                               const std::string& channel_name,
+                               const bool show_only,
+                               const std::string& show_only_channel_name,
+                               const uint16_t show_only_value,
+                               Transformed& out)
+    {
+        const int32_t index = findChannelIndex(cloud, channel_name);
+        const int32_t show_only_index = findChannelIndex(cloud, show_only_channel_name);
+        const uint32_t point_step = cloud->point_step;
+        const uint32_t num_points = cloud->width * cloud->height;
+
+        out.colors.resize(num_points);
+        out.hidden.assign(num_points, 0);
+        out.color_defined.assign(num_points, 1);
+        for (uint32_t i = 0; i < num_points; ++i)
+        {
+            auto val = valueFromCloud<uint16_t>(
+                cloud, cloud->fields[index].offset, cloud->fields[index].datatype, point_step, i);
+            out.colors[i] = ColorHelper::getOgreColorFromList(val % static_cast<int>(ColorHelper::getColorListSize()));
+            if (show_only)
+            {
+                auto show_only_val = valueFromCloud<uint16_t>(cloud,
+                                                              cloud->fields[show_only_index].offset,
+                                                              cloud->fields[show_only_index].datatype,
+                                                              point_step,
+                                                              i);
+                out.hidden[i] = show_only_val != show_only_value;
+            }
+        }
+    }
+
+    // the fused label and intensity transformer: the label colors scaled by the normalized shading channel
+    struct ShadingSettings
+    {
+        std::string channel_name;
+        bool shade_alpha{false};
+        float min_shading{0.2f};
+        bool auto_compute_bounds{true};
+        float min_intensity{0.f};
+        float max_intensity{4096.f};
+    };
+
+    inline void transformLabelIntensity(const sensor_msgs::PointCloud2ConstPtr& cloud,
+                                        const std::string& label_channel_name,
+                                        const ShadingSettings& settings,
+                                        const bool show_only,
+                                        const std::string& show_only_channel_name,
+                                        const uint16_t show_only_value,
+                                        Transformed& out)
+    {
+        transformLabel(cloud, label_channel_name, show_only, show_only_channel_name, show_only_value, out);
+        const int32_t index = findChannelIndex(cloud, settings.channel_name);
+        const uint32_t num_points = cloud->width * cloud->height;
+        std::vector<float> values(num_points);
+        for (uint32_t i = 0; i < num_points; ++i)
+        {
+            values[i] = valueFromCloud<float>(
+                cloud, cloud->fields[index].offset, cloud->fields[index].datatype, cloud->point_step, i);
+        }
+
+        float min_intensity = settings.min_intensity;
+        float max_intensity = settings.max_intensity;
+        if (settings.auto_compute_bounds)
+        {
+            min_intensity = 999999.0f;
+            max_intensity = -999999.0f;
+            for (uint32_t i = 0; i < num_points; ++i)
+            {
+                if (!out.hidden[i])
+                {
+                    min_intensity = std::min(values[i], min_intensity);
+                    max_intensity = std::max(values[i], max_intensity);
+                }
+            }
+            min_intensity = std::max(-999999.0f, min_intensity);
+            max_intensity = std::min(999999.0f, max_intensity);
+        }
+        float diff_intensity = max_intensity - min_intensity;
+        if (diff_intensity == 0)
+        {
+            diff_intensity = 1e20;
+        }
+
+        for (uint32_t i = 0; i < num_points; ++i)
+        {
+            // NaN values get the minimum shading
+            const float normalized = std::min(1.0f, std::max(0.0f, (values[i] - min_intensity) / diff_intensity));
+            const float shading = settings.min_shading + (1.0f - settings.min_shading) * normalized;
+            if (settings.shade_alpha)
+            {
+                out.colors[i].a = shading;
+            }
+            else
+            {
+                out.colors[i].r *= shading;
+                out.colors[i].g *= shading;
+                out.colors[i].b *= shading;
+            }
+        }
+    }
+
+    // the most frequent labels of the points inside the region, by descending count and ascending label
+    inline std::vector<std::pair<uint16_t, uint32_t>> topLabels(const sensor_msgs::PointCloud2ConstPtr& cloud,
+                                                                const std::string& channel_name,
+                                                                const size_t top_n,
+                                                                const std::vector<uint8_t>* outside = nullptr)
+    {
+        const int32_t index = findChannelIndex(cloud, channel_name);
+        std::map<uint16_t, uint32_t> counts;
+        for (uint32_t i = 0; i < cloud->width * cloud->height; ++i)
+        {
+            if (!outside || !(*outside)[i])
+            {
+                ++counts[readValue<uint16_t>(*cloud, cloud->fields[index], i)];
+            }
+        }
+        std::vector<std::pair<uint16_t, uint32_t>> labels(counts.begin(), counts.end());
+        std::stable_sort(labels.begin(),
+                         labels.end(),
+                         [](const std::pair<uint16_t, uint32_t>& a, const std::pair<uint16_t, uint32_t>& b)
+                         { return a.second > b.second; });
+        labels.resize(std::min(labels.size(), top_n));
+        return labels;
+    }
+
+    inline void transformIntensityLabel(const sensor_msgs::PointCloud2ConstPtr& cloud,
+                                        const ColorSettings& settings,
+                                        const bool show_only,
+                                        const std::string& show_only_channel_name,
+                                        const float show_only_value,
+                                        Transformed& out,
+                                        const std::vector<uint8_t>* outside = nullptr)
+    {
+        const int32_t show_only_index = findChannelIndex(cloud, show_only_channel_name);
+        const uint32_t point_step = cloud->point_step;
+        const uint32_t num_points = cloud->width * cloud->height;
+        const std::vector<float> values = channelValues(cloud, settings);
+
+        out.hidden.assign(num_points, 0);
+        if (show_only)
+        {
+            for (uint32_t i = 0; i < num_points; ++i)
+            {
+                auto show_only_val = valueFromCloud<float>(cloud,
+                                                           cloud->fields[show_only_index].offset,
+                                                           cloud->fields[show_only_index].datatype,
+                                                           point_step,
+                                                           i);
+                out.hidden[i] = show_only_val != show_only_value;
+            }
+        }
+        if (outside)
+        {
+            for (uint32_t i = 0; i < num_points; ++i)
+            {
+                out.hidden[i] |= (*outside)[i];
+            }
+        }
+
+        float min_intensity = 999999.0f;
+        float max_intensity = -999999.0f;
+        if (settings.auto_compute_bounds)
+        {
+            for (uint32_t i = 0; i < num_points; ++i)
+            {
+                float val = values[i];
+                if (!out.hidden[i])
+                {
+                    min_intensity = std::min(val, min_intensity);
+                    max_intensity = std::max(val, max_intensity);
+                }
+            }
+            min_intensity = std::max(-999999.0f, min_intensity);
+            max_intensity = std::min(999999.0f, max_intensity);
+        }
+        else
+        {
+            min_intensity = settings.min_intensity;
+            max_intensity = settings.max_intensity;
+        }
+
+        colorize(values, settings, min_intensity, max_intensity, out);
+    }
+
+    // the region of interest of the transformers, given in the sensor frame
+    struct Region
+    {
+        enum Shape
+        {
+            AXIS_ALIGNED_BOX,
+            ORIENTED_BOX,
+            CYLINDER
+        };
+        Shape shape{AXIS_ALIGNED_BOX};
+        Ogre::Vector3 center{0.f, 0.f, 0.f};
+        Ogre::Vector3 size{20.f, 20.f, 10.f};
+        float yaw{0.f};
+        float radius{10.f};
+        float height{10.f};
+    };
+
+    // non zero for the points outside the region, including points with NaN or infinite positions
+    inline std::vector<uint8_t> outsideRegion(const Region& region, const V_PointCloudPoint& points)
+    {
+        const double yaw = region.shape == Region::ORIENTED_BOX ? region.yaw * M_PI / 180.0 : 0.0;
+        std::vector<uint8_t> outside(points.size(), 1);
+        for (size_t i = 0; i < points.size(); ++i)
+        {
+            const Ogre::Vector3& p = points[i].position;
+            const double dx = p.x - region.center.x;
+            const double dy = p.y - region.center.y;
+            const double x = std::cos(yaw) * dx + std::sin(yaw) * dy;
+            const double y = -std::sin(yaw) * dx + std::cos(yaw) * dy;
+            const double z = p.z - region.center.z;
+            if (region.shape == Region::CYLINDER)
+            {
+                outside[i] = !(x * x + y * y <= region.radius * region.radius && std::abs(z) <= 0.5 * region.height);
+            }
+            else
+            {
+                outside[i] = !(std::abs(x) <= 0.5 * region.size.x && std::abs(y) <= 0.5 * region.size.y &&
+                               std::abs(z) <= 0.5 * region.size.z);
+            }
+        }
+        return outside;
+    }
+
+    // The range transformer keeps the bounds across clouds. The original accumulated them point by point into the
+    // persistent bounds, so a NaN value dropped the bounds of the earlier clouds. Here the bounds of each cloud are
+    // merged into them like the transformer does, which is the same without NaN values.
+    class RangeTransform
+    {
+      public:
+        ColorSettings color;
+        bool filter{false};
+        std::string filter_channel_name;
+        float lower_value{0.f};
+        float upper_value{0.f};
+        bool invert_filter{false};
+        bool persistent{true};
+
+        void transform(const sensor_msgs::PointCloud2ConstPtr& cloud, Transformed& out)
+        {
+            const int32_t filter_index = findChannelIndex(cloud, filter_channel_name);
+            const uint32_t point_step = cloud->point_step;
+            const uint32_t num_points = cloud->width * cloud->height;
+            const std::vector<float> values = channelValues(cloud, color);
+
+            out.hidden.assign(num_points, 0);
+            if (filter)
+            {
+                for (uint32_t i = 0; i < num_points; ++i)
+                {
+                    auto filter_val = valueFromCloud<float>(cloud,
+                                                            cloud->fields[filter_index].offset,
+                                                            cloud->fields[filter_index].datatype,
+                                                            point_step,
+                                                            i);
+                    out.hidden[i] = !test_value(filter_val, lower_value, upper_value, invert_filter);
+                }
+            }
+
+            float min_intensity = 999999.0f;
+            float max_intensity = -999999.0f;
+            if (color.auto_compute_bounds)
+            {
+                for (uint32_t i = 0; i < num_points; ++i)
+                {
+                    float val = values[i];
+                    if (!out.hidden[i])
+                    {
+                        min_intensity = std::min(val, min_intensity);
+                        max_intensity = std::max(val, max_intensity);
+                    }
+                }
+                min_intensity = std::max(-999999.0f, min_intensity);
+                max_intensity = std::min(999999.0f, max_intensity);
+                if (persistent)
+                {
+                    continuous_min_intensity_ = std::min(min_intensity, continuous_min_intensity_);
+                    continuous_max_intensity_ = std::max(max_intensity, continuous_max_intensity_);
+                    min_intensity = continuous_min_intensity_;
+                    max_intensity = continuous_max_intensity_;
+                }
+            }
+            else
+            {
+                min_intensity = color.min_intensity;
+                max_intensity = color.max_intensity;
+            }
+
+            colorize(values, color, min_intensity, max_intensity, out);
+        }
+
+      private:
+        float continuous_min_intensity_{999999.0f};
+        float continuous_max_intensity_{-999999.0f};
+    };
+
+} // namespace reference
+} // namespace test
+} // namespace rviz
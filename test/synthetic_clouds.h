@@ -0,0 +1,173 @@
+#pragma once
+
+#include <sensor_msgs/PointCloud2.h>
+#include <rviz/default_plugin/point_cloud_transformer.h>
+
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace rviz
+{
+namespace test
+{
+    struct FieldSpec
+    {
+        std::string name;
+        uint8_t datatype;
+    };
+
+    inline uint32_t datatypeSize(const uint8_t datatype)
+    {
+        switch (datatype)
+        {
+            case sensor_msgs::PointField::INT8:
+            case sensor_msgs::PointField::UINT8:
+                return 1;
+            case sensor_msgs::PointField::INT16:
+            case sensor_msgs::PointField::UINT16:
+                return 2;
+            case sensor_msgs::PointField::INT32:
+            case sensor_msgs::PointField::UINT32:
+            case sensor_msgs::PointField::FLOAT32:
+                return 4;
+            case sensor_msgs::PointField::FLOAT64:
+                return 8;
+            default:
+                return 0;
+        }
+    }
+
+    template <typename T>
+    inline void writeAs(uint8_t* data, const double value, const bool big_endian)
+    {
+        const T typed = static_cast<T>(value);
+        uint8_t bytes[sizeof(T)];
+        std::memcpy(bytes, &typed, sizeof(T));
+        // the tests run on little endian hosts like rviz
+        for (size_t b = 0; b < sizeof(T); ++b)
+        {
+            data[b] = bytes[big_endian ? sizeof(T) - 1 - b : b];
+        }
+    }
+
+    // value must be representable in the datatype, NaN only in float fields
+    inline void writeValue(uint8_t* data, const uint8_t datatype, const double value, const bool big_endian)
+    {
+        switch (datatype)
+        {
+            case sensor_msgs::PointField::INT8:
+                writeAs<int8_t>(data, value, big_endian);
+                break;
+            case sensor_msgs::PointField::UINT8:
+                writeAs<uint8_t>(data, value, big_endian);
+                break;
+            case sensor_msgs::PointField::INT16:
+                writeAs<int16_t>(data, value, big_endian);
+                break;
+            case sensor_msgs::PointField::UINT16:
+                writeAs<uint16_t>(data, value, big_endian);
+                break;
+            case sensor_msgs::PointField::INT32:
+                writeAs<int32_t>(data, value, big_endian);
+                break;
+            case sensor_msgs::PointField::UINT32:
+                writeAs<uint32_t>(data, value, big_endian);
+                break;
+            case sensor_msgs::PointField::FLOAT32:
+                writeAs<float>(data, value, big_endian);
+                break;
+            case sensor_msgs::PointField::FLOAT64:
+                writeAs<double>(data, value, big_endian);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Packs the fields in the given order, followed by padding bytes with garbage at the end of every point.
+    // value(field, point) returns the value of one field of one point.
+    inline sensor_msgs::PointCloud2Ptr makeCloud(const std::vector<FieldSpec>& fields,
+                                                 const uint32_t num_points,
+                                                 const uint32_t padding,
+                                                 const bool big_endian,
+                                                 const std::function<double(size_t, uint32_t)>& value)
+    {
+        sensor_msgs::PointCloud2Ptr cloud(new sensor_msgs::PointCloud2());
+        cloud->header.frame_id = "sensor";
+        cloud->header.stamp.sec = 1000;
+        cloud->height = 1;
+        cloud->width = num_points;
+        cloud->is_bigendian = big_endian;
+        cloud->is_dense = false;
+
+        uint32_t offset = 0;
+        for (const auto& spec : fields)
+        {
+            sensor_msgs::PointField field;
+            field.name = spec.name;
+            field.offset = offset;
+            field.datatype = spec.datatype;
+            field.count = 1;
+            cloud->fields.push_back(field);
+            offset += datatypeSize(spec.datatype);
+        }
+        cloud->point_step = offset + padding;
+        cloud->row_step = cloud->point_step * num_points;
+        cloud->data.assign(cloud->row_step, 0xAB);
+
+        for (uint32_t i = 0; i < num_points; ++i)
+        {
+            uint8_t* point = cloud->data.data() + i * cloud->point_step;
+            for (size_t f = 0; f < fields.size(); ++f)
+            {
+                writeValue(point + cloud->fields[f].offset, fields[f].datatype, value(f, i), big_endian);
+            }
+        }
+        return cloud;
+    }
+
+    // the points as rviz passes them to the color transformer: positions copied by the XYZ transformer in host byte
+    // order (garbage for big endian clouds) and white
+    inline void resetPoints(const sensor_msgs::PointCloud2& cloud, V_PointCloudPoint& points)
+    {
+        const uint32_t num_points = cloud.width * cloud.height;
+        points.resize(num_points);
+        uint32_t offsets[3] = {0, 0, 0};
+        bool has_xyz[3] = {false, false, false};
+        const char* names[3] = {"x", "y", "z"};
+        for (const auto& field : cloud.fields)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                if (field.name == names[axis] && field.datatype == sensor_msgs::PointField::FLOAT32)
+                {
+                    offsets[axis] = field.offset;
+                    has_xyz[axis] = true;
+                }
+            }
+        }
+        for (uint32_t i = 0; i < num_points; ++i)
+        {
+            const uint8_t* point = cloud.data.data() + i * cloud.point_step;
+            float xyz[3] = {0.f, 0.f, 0.f};
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                if (has_xyz[axis])
+                {
+                    std::memcpy(&xyz[axis], point + offsets[axis], sizeof(float));
+                }
+            }
+            points[i].position.x = xyz[0];
+            points[i].position.y = xyz[1];
+            points[i].position.z = xyz[2];
+            points[i].color.r = 1.f;
+            points[i].color.g = 1.f;
+            points[i].color.b = 1.f;
+            points[i].color.a = 1.f;
+        }
+    }
+
+} // namespace test
+} // namespace rviz
@@ -0,0 +1,323 @@
+// Replays synthetic clouds through the decoding kernels and the transformers and fails on any heap allocation once
+// the first clouds have sized the reused buffers. The transformers run on the thread of the test like on the message
+// thread of the display, the main thread which shows the properties has no event loop here.
+
+#include <gtest/gtest.h>
+
+#include <ros/ros.h>
+#include <rviz/properties/property.h>
+
+#include <QCoreApplication>
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <random>
+
+#include "field_reader.h"
+#include "normalization.h"
+#include "point_cloud_transformers.h"
+#include "region_of_interest.h"
+#include "voxel_thinning.h"
+
+#include "synthetic_clouds.h"
+#include "transformer_harness.h"
+
+namespace
+{
+// Only the allocations of the thread running the test are counted, roscpp allocates in its own threads at any time.
+thread_local bool counting = false;
+std::atomic<size_t> allocations{0};
+} // namespace
+
+void* operator new(std::size_t size)
+{
+    if (counting)
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    void* ptr = std::malloc(size > 0 ? size : 1);
+    if (!ptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace rviz
+{
+namespace test
+{
+namespace
+{
+    const uint32_t NUM_POINTS = 20000;
+    const size_t NUM_CLOUDS = 8;
+    // clouds replayed before counting, both byte orders have sized the buffers after them
+    const size_t NUM_WARM_UP_CLOUDS = 2;
+
+    // clouds with the same schema and size and different values, alternating between the byte orders
+    std::vector<sensor_msgs::PointCloud2ConstPtr> makeClouds()
+    {
+        const std::vector<FieldSpec> fields = {{"x", sensor_msgs::PointField::FLOAT32},
+                                               {"y", sensor_msgs::PointField::FLOAT32},
+                                               {"z", sensor_msgs::PointField::FLOAT32},
+                                               {"intensity", sensor_msgs::PointField::FLOAT32},
+                                               {"label", sensor_msgs::PointField::UINT16},
+                                               {"reflectivity", sensor_msgs::PointField::UINT8},
+                                               {"t", sensor_msgs::PointField::FLOAT64}};
+        std::vector<sensor_msgs::PointCloud2ConstPtr> clouds;
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<double> position(-50.0, 50.0);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        for (size_t c = 0; c < NUM_CLOUDS; ++c)
+        {
+            clouds.push_back(makeCloud(fields, NUM_POINTS, 3, c % 2 == 1, [&](size_t field, uint32_t point) -> double {
+                switch (field)
+                {
+                    case 0:
+                    case 1:
+                    case 2:
+                        return point % 97 == 0 ? std::numeric_limits<double>::quiet_NaN() : position(rng);
+                    case 3:
+                        return point % 89 == 0 ? std::numeric_limits<double>::quiet_NaN() : unit(rng) * 1000.0;
+                    case 4:
+                    {
+                        // halving label frequencies, so the ranking of the label statistics stays the same
+                        uint32_t label = 0;
+                        while (label < 15 && ((point + 1) >> label & 1) == 0)
+                        {
+                            ++label;
+                        }
+                        return label;
+                    }
+                    case 5:
+                        return std::floor(unit(rng) * 255.0);
+                    default:
+                        return 1000.0 + 0.1 * unit(rng);
+                }
+            }));
+        }
+        return clouds;
+    }
+
+    const std::vector<sensor_msgs::PointCloud2ConstPtr>& clouds()
+    {
+        static const std::vector<sensor_msgs::PointCloud2ConstPtr> clouds = makeClouds();
+        return clouds;
+    }
+
+    // replays the first clouds to size the buffers and returns the allocations while replaying all of them
+    template <typename Function>
+    size_t allocationsAfterWarmUp(Function function)
+    {
+        for (size_t c = 0; c < NUM_WARM_UP_CLOUDS; ++c)
+        {
+            function(clouds()[c]);
+        }
+        allocations = 0;
+        counting = true;
+        for (const auto& cloud : clouds())
+        {
+            function(cloud);
+        }
+        counting = false;
+        return allocations;
+    }
+
+    TEST(Allocations, readField)
+    {
+        std::vector<float> values;
+        std::vector<uint16_t> labels;
+        std::vector<double> times;
+        std::vector<float> offsets;
+        EXPECT_EQ(allocationsAfterWarmUp([&](const sensor_msgs::PointCloud2ConstPtr& cloud) {
+                      for (const auto& field : cloud->fields)
+                      {
+                          readField(*cloud, field, values);
+                          readField(*cloud, field, labels);
+                      }
+                      readTimeField(*cloud, cloud->fields[6], TIME_ORIGIN_HEADER, times, offsets);
+                      readTimeField(*cloud, cloud->fields[6], TIME_ORIGIN_MINIMUM, times, offsets);
+                  }),
+                  0u);
+    }
+
+    TEST(Allocations, Normalizer)
+    {
+        std::vector<float> values;
+        std::vector<float> normalized;
+        normalization::Normalizer normalizer;
+        EXPECT_EQ(allocationsAfterWarmUp([&](const sensor_msgs::PointCloud2ConstPtr& cloud) {
+                      for (const auto mode :
+                           {normalization::LINEAR, normalization::LOG, normalization::SQRT, normalization::GAMMA})
+                      {
+                          // float channel and integer channel with the lookup table
+                          readField(*cloud, cloud->fields[3], values);
+                          normalizer.setup(mode, 0.5f, 100.f, 0.f, 1000.f);
+                          normalizer.apply(values, false, normalized);
+                          readField(*cloud, cloud->fields[5], values);
+                          normalizer.setup(mode, 0.5f, 100.f, 0.f, 255.f);
+                          normalizer.apply(values, true, normalized);
+                      }
+                  }),
+                  0u);
+    }
+
+    TEST(Allocations, VoxelThinning)
+    {
+        V_PointCloudPoint points;
+        VoxelThinning voxel_thinning;
+        EXPECT_EQ(allocationsAfterWarmUp([&](const sensor_msgs::PointCloud2ConstPtr& cloud) {
+                      resetPoints(*cloud, points);
+                      voxel_thinning.apply(0.5f, points);
+                  }),
+                  0u);
+    }
+
+    TEST(Allocations, RegionOfInterest)
+    {
+        V_PointCloudPoint points;
+        Property root;
+        RegionOfInterest roi;
+        roi.createProperties(&root);
+        setProperty(&root, "Region of Interest", true);
+        for (const char* shape : {"Axis Aligned Box", "Oriented Box", "Cylinder"})
+        {
+            setProperty(&root, "Region of Interest/Shape", QString(shape));
+            EXPECT_EQ(allocationsAfterWarmUp([&](const sensor_msgs::PointCloud2ConstPtr& cloud) {
+                          resetPoints(*cloud, points);
+                          ASSERT_TRUE(roi.update(Ogre::Matrix4::IDENTITY, points));
+                      }),
+                      0u)
+                << shape;
+        }
+    }
+
+    // settings applied to a transformer before replaying the clouds
+    typedef std::vector<std::pair<std::string, QVariant>> Settings;
+
+    // The values shown in the properties are posted to the main thread. Without an event loop the post of the first
+    // warm-up cloud stays pending and is not repeated, while a property written by transform() itself would allocate
+    // a change event in the model of the harness.
+    template <typename Transformer>
+    void expectNoAllocations(const Settings& settings)
+    {
+        TransformerHarness<Transformer> harness;
+        for (const auto& setting : settings)
+        {
+            harness.set(setting.first, setting.second);
+        }
+        V_PointCloudPoint points;
+        EXPECT_EQ(allocationsAfterWarmUp([&](const sensor_msgs::PointCloud2ConstPtr& cloud) {
+                      ASSERT_TRUE(harness.transform(cloud, points));
+                  }),
+                  0u);
+    }
+
+    TEST(Allocations, LabelPCTransformer)
+    {
+        const Settings common = {{"Channel Name", QString("label")},
+                                 {"Label Statistics", true},
+                                 {"Voxel Thinning", true}};
+        Settings filters = common;
+        filters.insert(filters.end(),
+                       {{"Show only", true},
+                        {"Show only/Channel Name", QString("label")},
+                        {"Show only/Equal To", QString("1")},
+                        {"Region of Interest", true}});
+        expectNoAllocations<LabelPCTransformer>(common);
+        expectNoAllocations<LabelPCTransformer>(filters);
+    }
+
+    TEST(Allocations, IntensityLabelPCTransformer)
+    {
+        const Settings common = {{"Channel Name", QString("intensity")},
+                                 {"Normalization", QString("Log")},
+                                 {"Color Map", QString("Turbo")},
+                                 {"Voxel Thinning", true}};
+        Settings filters = common;
+        filters.insert(filters.end(),
+                       {{"Show only", true},
+                        {"Show only/Channel Name", QString("label")},
+                        {"Show only/Equal To", 1.f},
+                        {"Region of Interest", true}});
+        Settings time = common;
+        time.insert(time.end(), {{"Channel Name", QString("t")}, {"Time Channel", true}});
+        expectNoAllocations<IntensityLabelPCTransformer>(filters);
+        expectNoAllocations<IntensityLabelPCTransformer>(time);
+    }
+
+    TEST(Allocations, RangePCTransformer)
+    {
+        const Settings common = {{"Channel Name", QString("reflectivity")},
+                                 {"Normalization", QString("Gamma")},
+                                 {"Color Map", QString("Min/Max Color")},
+                                 {"Voxel Thinning", true}};
+        Settings filters = common;
+        filters.insert(filters.end(),
+                       {{"Filter range", true},
+                        {"Filter range/Channel Name", QString("intensity")},
+                        {"Filter range/Lower Limit", 200.f},
+                        {"Filter range/Upper Limit", 800.f},
+                        {"Region of Interest", true}});
+        Settings time = common;
+        time.insert(time.end(), {{"Time Channel", true}, {"Channel Name", QString("t")}});
+        expectNoAllocations<RangePCTransformer>(filters);
+        expectNoAllocations<RangePCTransformer>(time);
+    }
+
+    TEST(Allocations, LabelIntensityPCTransformer)
+    {
+        const Settings common = {{"Channel Name", QString("label")},
+                                 {"Shading Channel", QString("intensity")},
+                                 {"Shading Mode", QString("Alpha")},
+                                 {"Voxel Thinning", true}};
+        Settings filters = common;
+        filters.insert(filters.end(),
+                       {{"Show only", true},
+                        {"Show only/Channel Name", QString("label")},
+                        {"Show only/Equal To", 1},
+                        {"Region of Interest", true}});
+        expectNoAllocations<LabelIntensityPCTransformer>(common);
+        expectNoAllocations<LabelIntensityPCTransformer>(filters);
+    }
+
+} // namespace
+} // namespace test
+} // namespace rviz
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    // the label transformer creates a node handle for publishing its statistics
+    ros::init(argc, argv, "test_allocations", ros::init_options::AnonymousName | ros::init_options::NoRosout);
+    QCoreApplication app(argc, argv);
+    return RUN_ALL_TESTS();
+}
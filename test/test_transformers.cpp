@@ -0,0 +1,969 @@
+// Compares the kernels and the transformers with the scalar reference implementations on randomized clouds: every
+// datatype, padded points, NaN values, both byte orders and the combinations of filters, bounds, time channels,
+// normalization curves, color maps, regions of interest, palettes, shading and label statistics.
+
+#include <gtest/gtest.h>
+
+#include <ros/ros.h>
+#include <rviz/properties/property.h>
+#include <rviz/properties/vector_property.h>
+
+#include <QColor>
+#include <QCoreApplication>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <sstream>
+
+#include "color_maps.h"
+#include "field_reader.h"
+#include "normalization.h"
+#include "point_cloud_transformers.h"
+#include "voxel_thinning.h"
+
+#include "reference_transforms.h"
+#include "synthetic_clouds.h"
+#include "transformer_harness.h"
+
+namespace rviz
+{
+namespace test
+{
+namespace
+{
+    const uint8_t DATATYPES[] = {sensor_msgs::PointField::INT8,
+                                 sensor_msgs::PointField::UINT8,
+                                 sensor_msgs::PointField::INT16,
+                                 sensor_msgs::PointField::UINT16,
+                                 sensor_msgs::PointField::INT32,
+                                 sensor_msgs::PointField::UINT32,
+                                 sensor_msgs::PointField::FLOAT32,
+                                 sensor_msgs::PointField::FLOAT64};
+
+    // number of randomized clouds (or sequences of clouds) per test
+    const int NUM_TRIALS = 40;
+
+    // per channel tolerance of the rainbow table lookup: half a table step, the rainbow changes by 5 per unit
+    const float RAINBOW_TOLERANCE = 0.5f / (color_maps::TABLE_SIZE - 1) * 5.f + 1e-4f;
+    // the interpolation between Min and Max Color is computed the same way, only rounding may differ
+    const float MIN_MAX_TOLERANCE = 1e-5f;
+
+    bool isFloat(const uint8_t datatype)
+    {
+        return datatype == sensor_msgs::PointField::FLOAT32 || datatype == sensor_msgs::PointField::FLOAT64;
+    }
+
+    // random values representable in the datatype. Float channels get values of a random magnitude, some NaN and
+    // infinite values.
+    class ValueGenerator
+    {
+      public:
+        ValueGenerator(std::mt19937& rng, const uint8_t datatype) : rng_(rng), datatype_(datatype)
+        {
+            const double scales[] = {1.0, 1000.0, 1e7};
+            scale_ = scales[std::uniform_int_distribution<int>(0, 2)(rng_)];
+            nan_fraction_ = std::uniform_int_distribution<int>(0, 1)(rng_) ? 0.05 : 0.0;
+        }
+
+        double operator()()
+        {
+            std::uniform_real_distribution<double> unit(0.0, 1.0);
+            switch (datatype_)
+            {
+                case sensor_msgs::PointField::INT8:
+                    return std::uniform_int_distribution<int>(-128, 127)(rng_);
+                case sensor_msgs::PointField::UINT8:
+                    return std::uniform_int_distribution<int>(0, 255)(rng_);
+                case sensor_msgs::PointField::INT16:
+                    return std::uniform_int_distribution<int>(-32768, 32767)(rng_);
+                case sensor_msgs::PointField::UINT16:
+                    return std::uniform_int_distribution<int>(0, 65535)(rng_);
+                case sensor_msgs::PointField::INT32:
+                    return std::uniform_int_distribution<int32_t>(std::numeric_limits<int32_t>::min(),
+                                                                  std::numeric_limits<int32_t>::max())(rng_);
+                case sensor_msgs::PointField::UINT32:
+                    return std::uniform_int_distribution<uint32_t>(0, std::numeric_limits<uint32_t>::max())(rng_);
+                default:
+                {
+                    const double p = unit(rng_);
+                    if (p < nan_fraction_)
+                    {
+                        return std::numeric_limits<double>::quiet_NaN();
+                    }
+                    if (p < 1.2 * nan_fraction_)
+                    {
+                        return p < 1.1 * nan_fraction_ ? std::numeric_limits<double>::infinity()
+                                                       : -std::numeric_limits<double>::infinity();
+                    }
+                    return (2.0 * unit(rng_) - 1.0) * scale_;
+                }
+            }
+        }
+
+      private:
+        std::mt19937& rng_;
+        uint8_t datatype_;
+        double scale_;
+        double nan_fraction_;
+    };
+
+    // The same points packed in both byte orders. The fields are x, y, z, "value" and "filter" of random datatypes,
+    // an integer "label" and "time" stamps around the header stamp in random order, followed by 0 to 7 bytes of
+    // padding.
+    struct Clouds
+    {
+        sensor_msgs::PointCloud2Ptr little_endian;
+        sensor_msgs::PointCloud2Ptr big_endian;
+        std::string description;
+    };
+
+    class CloudGenerator
+    {
+      public:
+        explicit CloudGenerator(std::mt19937& rng) : rng_(rng)
+        {
+            fields_ = {{"x", sensor_msgs::PointField::FLOAT32},
+                       {"y", sensor_msgs::PointField::FLOAT32},
+                       {"z", sensor_msgs::PointField::FLOAT32},
+                       {"value", randomDatatype()},
+                       {"filter", randomDatatype()},
+                       {"label", randomDatatype()},
+                       {"time", sensor_msgs::PointField::FLOAT64}};
+            std::shuffle(fields_.begin(), fields_.end(), rng_);
+            padding_ = std::uniform_int_distribution<uint32_t>(0, 7)(rng_);
+            num_points_ = std::uniform_int_distribution<uint32_t>(1, 2000)(rng_);
+            for (const auto& field : fields_)
+            {
+                generators_.emplace_back(rng_, field.datatype);
+            }
+        }
+
+        // new values with the same schema
+        Clouds generate()
+        {
+            std::vector<std::vector<double>> values(fields_.size(), std::vector<double>(num_points_));
+            for (size_t f = 0; f < fields_.size(); ++f)
+            {
+                for (uint32_t i = 0; i < num_points_; ++i)
+                {
+                    // labels fit every datatype, so they can also be compared as floats. The time stamps are
+                    // within 0.1 s of the header stamp of makeCloud().
+                    if (fields_[f].name == "label")
+                    {
+                        values[f][i] = std::uniform_int_distribution<int>(0, 39)(rng_);
+                    }
+                    else if (fields_[f].name == "time")
+                    {
+                        values[f][i] = 1000.0 + std::uniform_real_distribution<double>(-0.1, 0.1)(rng_);
+                    }
+                    else
+                    {
+                        values[f][i] = generators_[f]();
+                    }
+                }
+            }
+            const auto value = [&](size_t field, uint32_t point) { return values[field][point]; };
+
+            Clouds clouds;
+            clouds.little_endian = makeCloud(fields_, num_points_, padding_, false, value);
+            clouds.big_endian = makeCloud(fields_, num_points_, padding_, true, value);
+            std::stringstream description;
+            for (const auto& field : fields_)
+            {
+                description << field.name << ":" << static_cast<int>(field.datatype) << " ";
+            }
+            description << "padding " << padding_ << ", " << num_points_ << " points";
+            clouds.description = description.str();
+            return clouds;
+        }
+
+      private:
+        uint8_t randomDatatype()
+        {
+            return DATATYPES[std::uniform_int_distribution<size_t>(0, sizeof(DATATYPES) - 1)(rng_)];
+        }
+
+        std::mt19937& rng_;
+        std::vector<FieldSpec> fields_;
+        std::vector<ValueGenerator> generators_;
+        uint32_t padding_;
+        uint32_t num_points_;
+    };
+
+    // one of the values of the channel in the cloud, as the reference reads it
+    template <typename T>
+    T pickValue(std::mt19937& rng, const sensor_msgs::PointCloud2ConstPtr& cloud, const std::string& channel)
+    {
+        const int32_t index = findChannelIndex(cloud, channel);
+        const uint32_t point = std::uniform_int_distribution<uint32_t>(0, cloud->width * cloud->height - 1)(rng);
+        return valueFromCloud<T>(
+            cloud, cloud->fields[index].offset, cloud->fields[index].datatype, cloud->point_step, point);
+    }
+
+    bool sameFloat(const float a, const float b)
+    {
+        return a == b || (std::isnan(a) && std::isnan(b));
+    }
+
+    // The final points of the transformer against the reference: hidden points must match exactly and be moved to
+    // the origin, the colors of the visible points must match per channel within the tolerance.
+    void expectMatches(const V_PointCloudPoint& points, const reference::Transformed& expected, const float tolerance)
+    {
+        ASSERT_EQ(points.size(), expected.hidden.size());
+        size_t hidden_mismatches = 0;
+        size_t color_mismatches = 0;
+        for (size_t i = 0; i < points.size(); ++i)
+        {
+            const PointCloud::Point& point = points[i];
+            const bool hidden = point.color.a == 0.f;
+            if (hidden != static_cast<bool>(expected.hidden[i]) ||
+                (hidden && (point.position.x != 0.f || point.position.y != 0.f || point.position.z != 0.f)))
+            {
+                if (hidden_mismatches < 5)
+                {
+                    ADD_FAILURE_AT(__FILE__, __LINE__) << "point " << i << " hidden " << hidden << ", expected "
+                                                       << static_cast<bool>(expected.hidden[i]) << ", position ("
+                                                       << point.position.x << ", " << point.position.y << ", "
+                                                       << point.position.z << ")";
+                }
+                ++hidden_mismatches;
+                continue;
+            }
+            if (hidden)
+            {
+                continue;
+            }
+            if (!expected.color_defined[i])
+            {
+                continue;
+            }
+            const Ogre::ColourValue& color = point.color;
+            const Ogre::ColourValue& expected_color = expected.colors[i];
+            if (!(std::abs(color.r - expected_color.r) <= tolerance && std::abs(color.g - expected_color.g) <= tolerance &&
+                  std::abs(color.b - expected_color.b) <= tolerance && color.a == expected_color.a))
+            {
+                if (color_mismatches < 5)
+                {
+                    ADD_FAILURE_AT(__FILE__, __LINE__)
+                        << "point " << i << " color (" << color.r << ", " << color.g << ", " << color.b << ", "
+                        << color.a << "), expected (" << expected_color.r << ", " << expected_color.g << ", "
+                        << expected_color.b << ", " << expected_color.a << ")";
+                }
+                ++color_mismatches;
+            }
+        }
+        EXPECT_EQ(hidden_mismatches, 0u);
+        EXPECT_EQ(color_mismatches, 0u);
+    }
+
+    // a cloud in the other byte order must give exactly the same points, positions included
+    void expectSamePoints(const V_PointCloudPoint& points, const V_PointCloudPoint& expected)
+    {
+        ASSERT_EQ(points.size(), expected.size());
+        size_t mismatches = 0;
+        for (size_t i = 0; i < points.size(); ++i)
+        {
+            const PointCloud::Point& a = points[i];
+            const PointCloud::Point& b = expected[i];
+            if (!(sameFloat(a.position.x, b.position.x) && sameFloat(a.position.y, b.position.y) &&
+                  sameFloat(a.position.z, b.position.z) && sameFloat(a.color.r, b.color.r) &&
+                  sameFloat(a.color.g, b.color.g) && sameFloat(a.color.b, b.color.b) && a.color.a == b.color.a))
+            {
+                ++mismatches;
+            }
+        }
+        EXPECT_EQ(mismatches, 0u) << "points of the big endian cloud differ";
+    }
+
+    // the options of the enum properties, in the order of their values
+    const char* const COLOR_MAP_NAMES[] = {"Rainbow", "Turbo", "Viridis", "Inferno", "Cyclic", "Min/Max Color"};
+    const char* const NORMALIZATION_NAMES[] = {"Linear", "Log", "Square Root", "Gamma"};
+    const char* const TIME_ORIGIN_NAMES[] = {"Header Stamp", "Scan Minimum", "None"};
+
+    // random channel, normalization, color map, colors and bounds
+    reference::ColorSettings randomColorSettings(std::mt19937& rng)
+    {
+        std::uniform_int_distribution<int> coin(0, 1);
+        std::uniform_int_distribution<int> channel(0, 255);
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+        reference::ColorSettings settings;
+        settings.time = coin(rng);
+        settings.channel_name = settings.time ? "time" : "value";
+        settings.time_origin = static_cast<TimeOrigin>(std::uniform_int_distribution<int>(0, 2)(rng));
+        settings.normalization = static_cast<normalization::Mode>(std::uniform_int_distribution<int>(0, 3)(rng));
+        settings.gamma = 0.1f + 3.f * unit(rng);
+        settings.log_scale = 0.01f + 1000.f * unit(rng) * unit(rng);
+        settings.color_map = static_cast<color_maps::ColorMap>(
+            std::uniform_int_distribution<int>(color_maps::RAINBOW, color_maps::MIN_MAX_COLOR)(rng));
+        settings.invert_color_map = coin(rng);
+        // colors as rviz converts them from the 8 bit color properties
+        for (Ogre::ColourValue* color : {&settings.min_color, &settings.max_color})
+        {
+            *color = Ogre::ColourValue(channel(rng) / 255.f, channel(rng) / 255.f, channel(rng) / 255.f, 1.f);
+        }
+        settings.auto_compute_bounds = coin(rng);
+        // bounds in seconds around the header stamp for time stamps
+        const float scale = settings.time ? 1e-4f : 1.f;
+        settings.min_intensity = scale * std::uniform_real_distribution<float>(-1000.f, 1000.f)(rng);
+        // equal bounds are handled specially
+        settings.max_intensity = settings.min_intensity +
+                                 (coin(rng) ? scale * std::uniform_real_distribution<float>(0.f, 2000.f)(rng) : 0.f);
+        return settings;
+    }
+
+    QColor toQColor(const Ogre::ColourValue& color)
+    {
+        return QColor(std::lround(color.r * 255.f), std::lround(color.g * 255.f), std::lround(color.b * 255.f));
+    }
+
+    template <typename Transformer>
+    void applyColorSettings(const reference::ColorSettings& settings, TransformerHarness<Transformer>& harness)
+    {
+        harness.set("Channel Name", QString::fromStdString(settings.channel_name));
+        harness.set("Time Channel", settings.time);
+        harness.set("Time Channel/Time Origin", QString(TIME_ORIGIN_NAMES[settings.time_origin]));
+        harness.set("Normalization", QString(NORMALIZATION_NAMES[settings.normalization]));
+        harness.set("Normalization/Gamma", settings.gamma);
+        harness.set("Normalization/Log Scale", settings.log_scale);
+        harness.set("Color Map", QString(COLOR_MAP_NAMES[settings.color_map]));
+        harness.set("Invert Color Map", settings.invert_color_map);
+        harness.set("Min Color", toQColor(settings.min_color));
+        harness.set("Max Color", toQColor(settings.max_color));
+        harness.set("Autocompute Intensity Bounds", settings.auto_compute_bounds);
+        if (!settings.auto_compute_bounds)
+        {
+            harness.set("Min Intensity", settings.min_intensity);
+            harness.set("Max Intensity", settings.max_intensity);
+        }
+    }
+
+    // Per channel tolerance of the colors: the table rows are half a step apart from the value and the curves of the
+    // normalization are approximated to 1e-3, both are scaled by the steepest slope of the color map.
+    float colorTolerance(const reference::ColorSettings& settings)
+    {
+        const float normalization_error = settings.normalization == normalization::LINEAR ? 0.f : 1e-3f;
+        if (settings.color_map == color_maps::MIN_MAX_COLOR)
+        {
+            return normalization_error + MIN_MAX_TOLERANCE;
+        }
+        if (settings.color_map == color_maps::RAINBOW && settings.normalization == normalization::LINEAR)
+        {
+            return RAINBOW_TOLERANCE;
+        }
+        const int num_samples = 100000;
+        float slope = 0.f;
+        color_maps::RGB last = reference::colorMapAt(settings.color_map, 0.f);
+        for (int k = 1; k <= num_samples; ++k)
+        {
+            const color_maps::RGB rgb = reference::colorMapAt(settings.color_map, static_cast<float>(k) / num_samples);
+            slope = std::max({slope, std::abs(rgb.r - last.r), std::abs(rgb.g - last.g), std::abs(rgb.b - last.b)});
+            last = rgb;
+        }
+        slope *= num_samples;
+        return slope * (0.5f / (color_maps::TABLE_SIZE - 1) + normalization_error) + 1e-4f;
+    }
+
+    std::string describe(const reference::ColorSettings& settings)
+    {
+        std::stringstream description;
+        if (settings.time)
+        {
+            description << "time from " << TIME_ORIGIN_NAMES[settings.time_origin] << ", ";
+        }
+        description << NORMALIZATION_NAMES[settings.normalization];
+        if (settings.normalization == normalization::LOG)
+        {
+            description << " " << settings.log_scale;
+        }
+        else if (settings.normalization == normalization::GAMMA)
+        {
+            description << " " << settings.gamma;
+        }
+        description << ", " << COLOR_MAP_NAMES[settings.color_map] << (settings.invert_color_map ? " inverted" : "");
+        if (settings.auto_compute_bounds)
+        {
+            description << ", autocomputed bounds";
+        }
+        else
+        {
+            description << ", bounds " << settings.min_intensity << " " << settings.max_intensity;
+        }
+        return description.str();
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------
+    // kernels
+
+    TEST(Kernels, readField)
+    {
+        std::mt19937 rng(1);
+        for (int trial = 0; trial < NUM_TRIALS; ++trial)
+        {
+            const Clouds clouds = CloudGenerator(rng).generate();
+            for (const sensor_msgs::PointCloud2Ptr& cloud : {clouds.little_endian, clouds.big_endian})
+            {
+                SCOPED_TRACE(clouds.description + (cloud->is_bigendian ? ", big endian" : ", little endian"));
+                std::vector<float> values;
+                std::vector<uint16_t> labels;
+                for (const auto& field : cloud->fields)
+                {
+                    readField(*cloud, field, values);
+                    readField(*cloud, field, labels);
+                    size_t mismatches = 0;
+                    for (uint32_t i = 0; i < cloud->width; ++i)
+                    {
+                        // compared bitwise, so NaN matches NaN
+                        const float expected = reference::readValue<float>(*cloud, field, i);
+                        mismatches += std::memcmp(&expected, &values[i], sizeof(float)) != 0;
+                        // labels are only read from integer and integral float fields
+                        if (!isFloat(field.datatype) || field.name == "label")
+                        {
+                            mismatches += reference::readValue<uint16_t>(*cloud, field, i) != labels[i];
+                        }
+                    }
+                    EXPECT_EQ(mismatches, 0u) << "field " << field.name;
+                }
+            }
+        }
+    }
+
+    // absolute float64 stamps around 1.7e9 s, where a float only resolves 128 s, must keep microsecond offsets
+    TEST(Kernels, readTimeField)
+    {
+        std::mt19937 rng(8);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        const std::vector<FieldSpec> fields = {{"time", sensor_msgs::PointField::FLOAT64}};
+        std::vector<double> times;
+        std::vector<float> offsets;
+        for (int trial = 0; trial < NUM_TRIALS; ++trial)
+        {
+            const uint32_t num_points = 1000;
+            const uint32_t stamp_sec = 1700000000u + std::uniform_int_distribution<uint32_t>(0, 100000000u)(rng);
+            const uint32_t stamp_nsec = std::uniform_int_distribution<uint32_t>(0, 999999999u)(rng);
+            const double stamp = stamp_sec + 1e-9 * stamp_nsec;
+            // a 0.1 s scan starting somewhere around the stamp, with 10 us between the points
+            const double start = stamp + 0.2 * unit(rng) - 0.1;
+            const auto offset = [](uint32_t point) { return 1e-5 * point; };
+            for (const bool big_endian : {false, true})
+            {
+                SCOPED_TRACE("stamp " + std::to_string(stamp) + (big_endian ? ", big endian" : ""));
+                const auto absolute = makeCloud(
+                    fields, num_points, 0, big_endian, [&](size_t, uint32_t point) { return start + offset(point); });
+                absolute->header.stamp.sec = stamp_sec;
+                absolute->header.stamp.nsec = stamp_nsec;
+                const auto relative = makeCloud(fields, num_points, 0, big_endian,
+                                                [&](size_t, uint32_t point) { return start - stamp + offset(point); });
+                relative->header.stamp = absolute->header.stamp;
+
+                readTimeField(*absolute, absolute->fields[0], TIME_ORIGIN_HEADER, times, offsets);
+                ASSERT_EQ(offsets.size(), num_points);
+                for (uint32_t i = 0; i < num_points; ++i)
+                {
+                    ASSERT_NEAR(offsets[i], start - stamp + offset(i), 1e-6) << "header stamp, point " << i;
+                }
+                readTimeField(*absolute, absolute->fields[0], TIME_ORIGIN_MINIMUM, times, offsets);
+                for (uint32_t i = 0; i < num_points; ++i)
+                {
+                    ASSERT_NEAR(offsets[i], offset(i), 1e-6) << "scan minimum, point " << i;
+                }
+                // offsets relative to the header stamp are used as they are, whatever the stamp
+                readTimeField(*relative, relative->fields[0], TIME_ORIGIN_NONE, times, offsets);
+                for (uint32_t i = 0; i < num_points; ++i)
+                {
+                    ASSERT_NEAR(offsets[i], start - stamp + offset(i), 1e-6) << "none, point " << i;
+                }
+            }
+        }
+    }
+
+    TEST(Kernels, Normalizer)
+    {
+        std::mt19937 rng(2);
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+        normalization::Normalizer normalizer;
+        std::vector<float> values;
+        std::vector<float> normalized;
+        for (int trial = 0; trial < NUM_TRIALS; ++trial)
+        {
+            for (const auto mode :
+                 {normalization::LINEAR, normalization::LOG, normalization::SQRT, normalization::GAMMA})
+            {
+                const bool integer_channel = trial % 2 == 1;
+                // the first trials use the minimum of the properties, where the curves are flattest
+                const bool minimum = trial < 2;
+                const float gamma = minimum ? 0.01f : 0.1f + 3.f * unit(rng);
+                const float log_scale = minimum ? 0.01f : 0.01f + 1000.f * unit(rng) * unit(rng);
+                // integer channels get integer bounds, so they use the table of the curve
+                const float min_value = integer_channel ? std::floor(200.f * unit(rng) - 100.f) : 200.f * unit(rng) - 100.f;
+                const float diff_value = integer_channel ? std::floor(1 + 1000.f * unit(rng)) : 0.01f + 1000.f * unit(rng);
+                values.resize(2000);
+                for (size_t i = 0; i < values.size(); ++i)
+                {
+                    const float value = min_value - 0.2f * diff_value + 1.4f * diff_value * unit(rng);
+                    values[i] = integer_channel ? std::floor(value) : (i % 50 == 0 ? NAN : value);
+                }
+
+                normalizer.setup(mode, gamma, log_scale, min_value, diff_value);
+                normalizer.apply(values, integer_channel, normalized);
+                ASSERT_EQ(normalized.size(), values.size());
+                // a fraction of a color table step
+                const float tolerance = 1e-3f;
+                size_t mismatches = 0;
+                for (size_t i = 0; i < values.size(); ++i)
+                {
+                    const float expected = reference::clampNormalized(
+                        reference::normalize(mode, gamma, log_scale, min_value, diff_value, values[i]));
+                    mismatches += !(std::abs(reference::clampNormalized(normalized[i]) - expected) <= tolerance);
+                }
+                EXPECT_EQ(mismatches, 0u) << "mode " << mode << ", integer channel " << integer_channel << ", gamma "
+                                          << gamma << ", log scale " << log_scale << ", min " << min_value
+                                          << ", diff " << diff_value;
+            }
+        }
+    }
+
+    // the rainbow table replaced the per point HSV conversion of the original transformers
+    TEST(Kernels, RainbowTable)
+    {
+        for (int k = 0; k <= 10000; ++k)
+        {
+            const float t = static_cast<float>(k) / 10000.f;
+            Ogre::ColourValue expected;
+            reference::getRainbowColorLabel(1.f - t, expected);
+            const float* rgb = color_maps::RAINBOW_TABLE.rgb[color_maps::getIndex(t)];
+            EXPECT_NEAR(rgb[0], expected.r, RAINBOW_TOLERANCE) << "t " << t;
+            EXPECT_NEAR(rgb[1], expected.g, RAINBOW_TOLERANCE) << "t " << t;
+            EXPECT_NEAR(rgb[2], expected.b, RAINBOW_TOLERANCE) << "t " << t;
+        }
+    }
+
+    TEST(Kernels, VoxelThinning)
+    {
+        std::mt19937 rng(3);
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+        VoxelThinning voxel_thinning;
+        V_PointCloudPoint points;
+        for (int trial = 0; trial < NUM_TRIALS; ++trial)
+        {
+            const float voxel_size = 0.01f + unit(rng);
+            // clusters of points sharing voxels, some hidden, some far away or NaN
+            points.resize(std::uniform_int_distribution<size_t>(1, 5000)(rng));
+            const float extent = 20.f * unit(rng);
+            for (auto& point : points)
+            {
+                const float p = unit(rng);
+                const float scale = p < 0.01f ? 1e12f : extent;
+                point.position.x = p < 0.02f && p >= 0.01f ? NAN : (2.f * unit(rng) - 1.f) * scale;
+                point.position.y = (2.f * unit(rng) - 1.f) * scale;
+                point.position.z = (2.f * unit(rng) - 1.f) * scale;
+                point.color = Ogre::ColourValue(1.f, 1.f, 1.f, p > 0.9f ? 0.f : 1.f);
+            }
+            const size_t occupied_voxels = reference::countOccupiedVoxels(voxel_size, points);
+
+            voxel_thinning.apply(voxel_size, points);
+
+            // exactly one visible point per voxel occupied before the thinning
+            EXPECT_EQ(reference::countOccupiedVoxels(voxel_size, points, true), occupied_voxels)
+                << "voxel size " << voxel_size << ", extent " << extent;
+            EXPECT_EQ(reference::countOccupiedVoxels(voxel_size, points), occupied_voxels);
+        }
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------
+    // transformers
+
+    TEST(Transformers, LabelPCTransformer)
+    {
+        std::mt19937 rng(4);
+        std::uniform_int_distribution<int> coin(0, 1);
+        for (int trial = 0; trial < NUM_TRIALS; ++trial)
+        {
+            const Clouds clouds = CloudGenerator(rng).generate();
+            TransformerHarness<LabelPCTransformer> harness;
+            const bool show_only = coin(rng);
+            const uint16_t show_only_value = pickValue<uint16_t>(rng, clouds.little_endian, "label");
+            harness.set("Channel Name", QString("label"));
+            harness.set("Show only", show_only);
+            harness.set("Show only/Channel Name", QString("label"));
+            harness.set("Show only/Equal To", QString::number(static_cast<int>(show_only_value)));
+            SCOPED_TRACE(clouds.description + (show_only ? ", show only " + std::to_string(show_only_value) : ""));
+
+            reference::Transformed expected;
+            reference::transformLabel(clouds.little_endian, "label", show_only, "label", show_only_value, expected);
+
+            V_PointCloudPoint points;
+            V_PointCloudPoint swapped_points;
+            ASSERT_TRUE(harness.transform(clouds.little_endian, points));
+            expectMatches(points, expected, 0.f);
+            ASSERT_TRUE(harness.transform(clouds.big_endian, swapped_points));
+            expectSamePoints(swapped_points, points);
+        }
+    }
+
+    // writes a palette which names the labels "class<label>", colors them and hides label 7, returns its path
+    std::string writePaletteFile()
+    {
+        const std::string path = testing::TempDir() + "test_transformers_palette.csv";
+        std::ofstream file(path);
+        file << "id,name,r,g,b,visible\n";
+        for (int label = 0; label < 40; ++label)
+        {
+            file << label << ",class" << label << ",0," << 5 * label << ",255," << (label != 7) << "\n";
+        }
+        return path;
+    }
+
+    // A palette file which fails to load keeps the last good palette, only an empty path clears it. Settings make the
+    // transformer show the plain label colors.
+    template <typename Transformer>
+    void expectPaletteReload(const std::vector<std::pair<std::string, QVariant>>& settings)
+    {
+        std::mt19937 rng(9);
+        const Clouds clouds = CloudGenerator(rng).generate();
+        const std::string path = writePaletteFile();
+        TransformerHarness<Transformer> harness;
+        for (const auto& setting : settings)
+        {
+            harness.set(setting.first, setting.second);
+        }
+
+        reference::Transformed expected;
+        reference::transformLabel(clouds.little_endian, "label", false, "label", 0, expected);
+        reference::Transformed expected_palette = expected;
+        const int32_t index = findChannelIndex(clouds.little_endian, "label");
+        for (size_t i = 0; i < expected_palette.colors.size(); ++i)
+        {
+            const uint16_t label =
+                reference::readValue<uint16_t>(*clouds.little_endian, clouds.little_endian->fields[index], i);
+            expected_palette.colors[i] = Ogre::ColourValue(0.f, 5 * label / 255.f, 1.f);
+            expected_palette.hidden[i] = label == 7;
+        }
+
+        V_PointCloudPoint points;
+        harness.set("Palette File", QString::fromStdString(path));
+        ASSERT_TRUE(harness.transform(clouds.little_endian, points));
+        expectMatches(points, expected_palette, 1e-6f);
+
+        harness.set("Palette File", QString::fromStdString(path + ".missing"));
+        ASSERT_TRUE(harness.transform(clouds.little_endian, points));
+        expectMatches(points, expected_palette, 1e-6f);
+
+        harness.set("Palette File", QString(""));
+        ASSERT_TRUE(harness.transform(clouds.little_endian, points));
+        expectMatches(points, expected, 0.f);
+        std::remove(path.c_str());
+    }
+
+    TEST(Transformers, LabelPaletteReload)
+    {
+        expectPaletteReload<LabelPCTransformer>({{"Channel Name", QString("label")}});
+    }
+
+    TEST(Transformers, LabelIntensityPaletteReload)
+    {
+        // full shading leaves the label colors as they are
+        expectPaletteReload<LabelIntensityPCTransformer>(
+            {{"Channel Name", QString("label")}, {"Shading Channel", QString("value")}, {"Min Shading", 1.f}});
+    }
+
+    // the rows below "Counts" must show the labels and counts, the other rows must be hidden
+    void expectCountRows(Property* counts, const std::vector<std::pair<uint16_t, uint32_t>>& expected, bool named)
+    {
+        ASSERT_GE(static_cast<size_t>(counts->numChildren()), expected.size());
+        for (int i = 0; i < counts->numChildren(); ++i)
+        {
+            const Property* row = counts->childAt(i);
+            if (static_cast<size_t>(i) >= expected.size())
+            {
+                EXPECT_TRUE(row->getHidden()) << "row " << i;
+                continue;
+            }
+            const std::string label = std::to_string(expected[i].first);
+            EXPECT_FALSE(row->getHidden()) << "row " << i;
+            EXPECT_EQ(row->getName().toStdString(), "Label " + label + (named ? " (class" + label + ")" : ""));
+            EXPECT_EQ(row->getValue().toInt(), static_cast<int>(expected[i].second)) << "row " << i;
+        }
+    }
+
+    // The counts are shown by the main thread after the transform, sequences of clouds with a changing Top N create
+    // and hide rows. Points outside the region of interest are not counted.
+    TEST(Transformers, LabelStatistics)
+    {
+        std::mt19937 rng(11);
+        std::uniform_int_distribution<int> coin(0, 1);
+        std::uniform_int_distribution<int> top_n(1, 8);
+        const std::string path = writePaletteFile();
+        for (int trial = 0; trial < NUM_TRIALS; ++trial)
+        {
+            CloudGenerator generator(rng);
+            TransformerHarness<LabelPCTransformer> harness;
+            const bool named = coin(rng);
+            const bool roi = coin(rng);
+            harness.set("Channel Name", QString("label"));
+            harness.set("Label Statistics", true);
+            harness.set("Palette File", QString::fromStdString(named ? path : ""));
+            // the default box of 20 x 20 x 10 m holds the points of clouds with a small scale and few of the others
+            harness.set("Region of Interest", roi);
+            Property* counts = findProperty(harness.root, "Label Statistics/Counts");
+            ASSERT_NE(counts, nullptr);
+            std::vector<std::pair<uint16_t, uint32_t>> shown;
+            for (int c = 0; c < 3; ++c)
+            {
+                const int n = top_n(rng);
+                harness.set("Label Statistics/Top N", n);
+                const Clouds clouds = generator.generate();
+                SCOPED_TRACE(clouds.description + ", top " + std::to_string(n) + (named ? ", palette" : "") +
+                             (roi ? ", region" : "") + ", cloud " + std::to_string(c));
+
+                V_PointCloudPoint points;
+                resetPoints(*clouds.little_endian, points);
+                const std::vector<uint8_t> outside = reference::outsideRegion(reference::Region(), points);
+                ASSERT_TRUE(harness.transform(clouds.little_endian, points));
+                // transform() does not touch the rows, the counts of the last cloud are shown until the main thread
+                // updates them. Only the rows beyond Top N were hidden right away.
+                if (shown.size() > static_cast<size_t>(n))
+                {
+                    shown.resize(n);
+                }
+                expectCountRows(counts, shown, named);
+                QCoreApplication::processEvents();
+                shown = reference::topLabels(clouds.little_endian, "label", n, roi ? &outside : nullptr);
+                expectCountRows(counts, shown, named);
+            }
+        }
+        std::remove(path.c_str());
+    }
+
+    TEST(Transformers, IntensityLabelPCTransformer)
+    {
+        std::mt19937 rng(5);
+        std::uniform_int_distribution<int> coin(0, 1);
+        for (int trial = 0; trial < NUM_TRIALS; ++trial)
+        {
+            const Clouds clouds = CloudGenerator(rng).generate();
+            TransformerHarness<IntensityLabelPCTransformer> harness;
+            std::stringstream description;
+            description << clouds.description << ", ";
+            const reference::ColorSettings settings = randomColorSettings(rng);
+            applyColorSettings(settings, harness);
+            description << describe(settings);
+            const bool show_only = coin(rng);
+            const float show_only_value = pickValue<float>(rng, clouds.little_endian, "label");
+            harness.set("Show only", show_only);
+            harness.set("Show only/Channel Name", QString("label"));
+            harness.set("Show only/Equal To", show_only_value);
+            if (show_only)
+            {
+                description << ", show only " << show_only_value;
+            }
+            SCOPED_TRACE(description.str());
+
+            reference::Transformed expected;
+            reference::transformIntensityLabel(clouds.little_endian, settings, show_only, "label", show_only_value,
+                                               expected);
+
+            V_PointCloudPoint points;
+            V_PointCloudPoint swapped_points;
+            ASSERT_TRUE(harness.transform(clouds.little_endian, points));
+            expectMatches(points, expected, colorTolerance(settings));
+            ASSERT_TRUE(harness.transform(clouds.big_endian, swapped_points));
+            expectSamePoints(swapped_points, points);
+        }
+    }
+
+    // points outside the region are hidden and left out of the autocomputed bounds
+    TEST(Transformers, RegionOfInterest)
+    {
+        std::mt19937 rng(10);
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+        const char* shapes[] = {"Axis Aligned Box", "Oriented Box", "Cylinder"};
+        for (int trial = 0; trial < NUM_TRIALS; ++trial)
+        {
+            const Clouds clouds = CloudGenerator(rng).generate();
+            TransformerHarness<IntensityLabelPCTransformer> harness;
+            reference::ColorSettings settings = randomColorSettings(rng);
+            settings.auto_compute_bounds = true;
+            applyColorSettings(settings, harness);
+
+            // a region around a random point of the cloud, so it holds some of the points
+            V_PointCloudPoint points;
+            resetPoints(*clouds.little_endian, points);
+            Ogre::Vector3 anchor = points[std::uniform_int_distribution<size_t>(0, points.size() - 1)(rng)].position;
+            if (!std::isfinite(anchor.x + anchor.y + anchor.z))
+            {
+                anchor = Ogre::Vector3(0.f, 0.f, 0.f);
+            }
+            const float extent = std::max({std::abs(anchor.x), std::abs(anchor.y), std::abs(anchor.z), 1.f});
+            reference::Region region;
+            region.shape = static_cast<reference::Region::Shape>(trial % 3);
+            region.center = anchor * unit(rng);
+            region.size = Ogre::Vector3(unit(rng), unit(rng), unit(rng)) * 2.f * extent;
+            region.yaw = 360.f * unit(rng);
+            region.radius = unit(rng) * extent;
+            region.height = 2.f * unit(rng) * extent;
+            harness.set("Region of Interest", true);
+            harness.set("Region of Interest/Shape", QString(shapes[region.shape]));
+            // the display passes the transform into the fixed frame, the identity makes both frames the same
+            harness.set("Region of Interest/Frame", QString(trial % 2 ? "Sensor Frame" : "Fixed Frame"));
+            for (const auto& vector : {std::make_pair("Center", region.center), std::make_pair("Size", region.size)})
+            {
+                auto* property = dynamic_cast<VectorProperty*>(
+                    findProperty(harness.root, std::string("Region of Interest/") + vector.first));
+                ASSERT_NE(property, nullptr) << vector.first;
+                property->setVector(vector.second);
+            }
+            harness.set("Region of Interest/Yaw", region.yaw);
+            harness.set("Region of Interest/Radius", region.radius);
+            harness.set("Region of Interest/Height", region.height);
+            SCOPED_TRACE(clouds.description + ", " + describe(settings) + ", " + shapes[region.shape]);
+
+            const std::vector<uint8_t> outside = reference::outsideRegion(region, points);
+            reference::Transformed expected;
+            reference::transformIntensityLabel(clouds.little_endian, settings, false, "label", 0.f, expected, &outside);
+
+            V_PointCloudPoint swapped_points;
+            ASSERT_TRUE(harness.transform(clouds.little_endian, points));
+            expectMatches(points, expected, colorTolerance(settings));
+            ASSERT_TRUE(harness.transform(clouds.big_endian, swapped_points));
+            expectSamePoints(swapped_points, points);
+        }
+    }
+
+    // sequences of clouds, so the persistent bounds are compared too
+    TEST(Transformers, RangePCTransformer)
+    {
+        std::mt19937 rng(6);
+        std::uniform_int_distribution<int> coin(0, 1);
+        for (int trial = 0; trial < NUM_TRIALS; ++trial)
+        {
+            CloudGenerator generator(rng);
+            Clouds clouds = generator.generate();
+            TransformerHarness<RangePCTransformer> little_endian_harness;
+            TransformerHarness<RangePCTransformer> big_endian_harness;
+            reference::RangeTransform range;
+            std::stringstream description;
+            description << clouds.description << ", ";
+            range.color = randomColorSettings(rng);
+            description << describe(range.color);
+
+            range.filter = coin(rng);
+            range.filter_channel_name = "filter";
+            range.invert_filter = coin(rng);
+            range.lower_value = pickValue<float>(rng, clouds.little_endian, "filter");
+            range.upper_value = pickValue<float>(rng, clouds.little_endian, "filter");
+            if (range.upper_value < range.lower_value)
+            {
+                std::swap(range.lower_value, range.upper_value);
+            }
+            range.persistent = coin(rng);
+            for (auto* harness : {&little_endian_harness, &big_endian_harness})
+            {
+                applyColorSettings(range.color, *harness);
+                harness->set("Filter range", range.filter);
+                harness->set("Filter range/Channel Name", QString::fromStdString(range.filter_channel_name));
+                harness->set("Filter range/Lower Limit", range.lower_value);
+                harness->set("Filter range/Upper Limit", range.upper_value);
+                harness->set("Filter range/Invert Filter", range.invert_filter);
+                harness->set("Persistent Intensity values", range.persistent);
+            }
+            if (range.filter)
+            {
+                description << ", filter " << (range.invert_filter ? "outside " : "") << range.lower_value << " "
+                            << range.upper_value;
+            }
+            description << (range.persistent ? ", persistent" : "");
+
+            V_PointCloudPoint points;
+            V_PointCloudPoint swapped_points;
+            reference::Transformed expected;
+            for (int c = 0; c < 3; ++c)
+            {
+                SCOPED_TRACE(description.str() + ", cloud " + std::to_string(c));
+                if (c > 0)
+                {
+                    clouds = generator.generate();
+                }
+                range.transform(clouds.little_endian, expected);
+                ASSERT_TRUE(little_endian_harness.transform(clouds.little_endian, points));
+                expectMatches(points, expected, colorTolerance(range.color));
+                ASSERT_TRUE(big_endian_harness.transform(clouds.big_endian, swapped_points));
+                expectSamePoints(swapped_points, points);
+            }
+        }
+    }
+
+    // the fused transformer has no original, it is compared with the label reference scaled by the shading
+    TEST(Transformers, LabelIntensityPCTransformer)
+    {
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<int> coin(0, 1);
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+        for (int trial = 0; trial < NUM_TRIALS; ++trial)
+        {
+            const Clouds clouds = CloudGenerator(rng).generate();
+            TransformerHarness<LabelIntensityPCTransformer> harness;
+            reference::ShadingSettings shading;
+            shading.channel_name = "value";
+            shading.shade_alpha = coin(rng);
+            // alpha shading keeps points with an alpha of 0 in place, so they are not compared as hidden points
+            shading.min_shading = shading.shade_alpha ? 0.01f + 0.99f * unit(rng) : (coin(rng) ? unit(rng) : 0.f);
+            shading.auto_compute_bounds = coin(rng);
+            shading.min_intensity = std::uniform_real_distribution<float>(-1000.f, 1000.f)(rng);
+            shading.max_intensity = shading.min_intensity + 2000.f * unit(rng);
+            const bool show_only = coin(rng);
+            const uint16_t show_only_value = pickValue<uint16_t>(rng, clouds.little_endian, "label");
+            harness.set("Channel Name", QString("label"));
+            harness.set("Shading Channel", QString::fromStdString(shading.channel_name));
+            harness.set("Shading Mode", QString(shading.shade_alpha ? "Alpha" : "Brightness"));
+            harness.set("Min Shading", shading.min_shading);
+            harness.set("Autocompute Intensity Bounds", shading.auto_compute_bounds);
+            if (!shading.auto_compute_bounds)
+            {
+                harness.set("Min Intensity", shading.min_intensity);
+                harness.set("Max Intensity", shading.max_intensity);
+            }
+            harness.set("Show only", show_only);
+            harness.set("Show only/Channel Name", QString("label"));
+            harness.set("Show only/Equal To", static_cast<int>(show_only_value));
+            std::stringstream description;
+            description << clouds.description << ", " << (shading.shade_alpha ? "alpha" : "brightness") << " from "
+                        << shading.min_shading;
+            if (!shading.auto_compute_bounds)
+            {
+                description << ", bounds " << shading.min_intensity << " " << shading.max_intensity;
+            }
+            if (show_only)
+            {
+                description << ", show only " << show_only_value;
+            }
+            SCOPED_TRACE(description.str());
+
+            reference::Transformed expected;
+            reference::transformLabelIntensity(
+                clouds.little_endian, "label", shading, show_only, "label", show_only_value, expected);
+
+            V_PointCloudPoint points;
+            V_PointCloudPoint swapped_points;
+            ASSERT_TRUE(harness.transform(clouds.little_endian, points));
+            expectMatches(points, expected, MIN_MAX_TOLERANCE);
+            ASSERT_TRUE(harness.transform(clouds.big_endian, swapped_points));
+            expectSamePoints(swapped_points, points);
+        }
+    }
+
+} // namespace
+} // namespace test
+} // namespace rviz
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    // the label transformer creates a node handle for publishing its statistics
+    ros::init(argc, argv, "test_transformers", ros::init_options::AnonymousName | ros::init_options::NoRosout);
+    QCoreApplication app(argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <rviz/properties/property.h>
+#include <rviz/properties/property_tree_model.h>
+
+#include <sstream>
+#include <string>
+
+#include "synthetic_clouds.h"
+
+namespace rviz
+{
+namespace test
+{
+    // property below root by a path of names like "Filter range/Lower Limit", nullptr if there is none
+    inline Property* findProperty(Property* root, const std::string& path)
+    {
+        Property* property = root;
+        std::stringstream names(path);
+        std::string name;
+        while (std::getline(names, name, '/'))
+        {
+            Property* child = nullptr;
+            for (int i = 0; i < property->numChildren() && !child; ++i)
+            {
+                if (property->childAt(i)->getName().toStdString() == name)
+                {
+                    child = property->childAt(i);
+                }
+            }
+            if (!child)
+            {
+                return nullptr;
+            }
+            property = child;
+        }
+        return property;
+    }
+
+    inline void setProperty(Property* root, const std::string& path, const QVariant& value)
+    {
+        Property* property = findProperty(root, path);
+        ASSERT_NE(property, nullptr) << "no property " << path;
+        property->setValue(value);
+    }
+
+    // A transformer with its properties below an own root, fed like the point cloud display feeds it. The root is
+    // shown in a model like the properties of a display, so property changes notify it as in rviz.
+    template <typename Transformer>
+    struct TransformerHarness
+    {
+        TransformerHarness() : model(new Property()), root(model.getRoot())
+        {
+            QList<Property*> properties;
+            transformer.createProperties(root, PointCloudTransformer::Support_Color, properties);
+        }
+
+        void set(const std::string& path, const QVariant& value)
+        {
+            setProperty(root, path, value);
+        }
+
+        bool transform(const sensor_msgs::PointCloud2ConstPtr& cloud, V_PointCloudPoint& points)
+        {
+            resetPoints(*cloud, points);
+            // the display asks every transformer on a new cloud and the color transformer again before using it
+            transformer.supports(cloud);
+            transformer.supports(cloud);
+            return transformer.transform(cloud, PointCloudTransformer::Support_Color, Ogre::Matrix4::IDENTITY, points);
+        }
+
+        // owns the root
+        PropertyTreeModel model;
+        Property* root;
+        // declared after the model, so it is destroyed while its properties still exist
+        Transformer transformer;
+    };
+
+} // namespace test
+} // namespace rviz